@@ -2,6 +2,10 @@
 
 #pragma once
 
+#include <cassert>
+#include <string>
+#include <vector>
+
 #include "bitset.h"
 #include "worldstate.h"
 
@@ -22,16 +26,58 @@ struct Action : NoCopy
 	key_map eff;
 	std::string name = {};
 	int8_t cost = 0;
+
+	// Compiled form of pre/eff, built by ActionFinalize.
+	// Preconditions hold when (state & preMask) == preValue.
+	// Effects apply as (state & ~effClear) | effSet.
+	bitset_t preMask = {};
+	bitset_t preValue = {};
+	bitset_t effSet = {};
+	bitset_t effClear = {};
+	bool finalized = false;
 };
 
 inline void ActionAddPrecondition(Action& action, const key_type& key, bool value)
 {
 	action.pre.insert({ key, value });
+	action.finalized = false;
 }
 
 inline void ActionAddEffect(Action& action, const key_type& key, bool value)
 {
 	action.eff.insert({ key, value });
+	action.finalized = false;
+}
+
+// Builds the compiled masks from pre/eff. Must be called after the last
+// ActionAddPrecondition/ActionAddEffect and before planning with the action.
+inline void ActionFinalize(Action& action)
+{
+	BitsetInit(action.preMask);
+	BitsetInit(action.preValue);
+	BitsetInit(action.effSet);
+	BitsetInit(action.effClear);
+
+	for (const auto& kvp : action.pre)
+	{
+		BitsetSet(action.preMask, kvp.first);
+		BitsetWrite(action.preValue, kvp.first, kvp.second);
+	}
+
+	for (const auto& kvp : action.eff)
+	{
+		BitsetWrite(kvp.second ? action.effSet : action.effClear, kvp.first, true);
+	}
+
+	action.finalized = true;
+}
+
+inline void ActionsFinalize(const std::vector<Action*>& actions)
+{
+	for (Action* action : actions)
+	{
+		ActionFinalize(*action);
+	}
 }
 
 inline void ActionPrint(const Action& action)
@@ -41,20 +87,12 @@ inline void ActionPrint(const Action& action)
 
 inline void ActionApplyEffect(const Action& action, WorldState& state)
 {
-	for (const auto& kvp : action.eff)
-	{
-		BitsetWrite(state.stateBits, kvp.first, kvp.second);
-	}
+	assert(action.finalized && "ActionFinalize must be called before planning");
+	state.stateBits = (state.stateBits & ~action.effClear) | action.effSet;
 }
 
 inline bool ActionMeetsPreconditions(const Action& action, const WorldState& state)
 {
-	for (const auto& kvp : action.pre)
-	{
-		if (BitsetRead(state.stateBits, kvp.first) != kvp.second)
-		{
-			return false;
-		}
-	}
-	return true;
+	assert(action.finalized && "ActionFinalize must be called before planning");
+	return (state.stateBits & action.preMask) == action.preValue;
 }
\ No newline at end of file
@@ -0,0 +1,184 @@
+// Michael Adaixo - 2025
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#include "action.h"
+#include "state_table.h"
+
+// One array of an ActionTable. Owns its elements, or views elements owned by someone else,
+// such as the read-only mapping of a domain file (see domain_file.h). Viewed elements must not be written.
+template<typename T>
+struct ActionTableArray
+{
+	ActionTableArray() = default;
+	ActionTableArray(const ActionTableArray& other) { *this = other; }
+	ActionTableArray& operator=(const ActionTableArray& other)
+	{
+		if (this != &other)
+		{
+			storage = other.storage;
+			items = other.owned() ? storage.data() : other.items;
+			count = other.count;
+		}
+		return *this;
+	}
+
+	// Owns count copies of value.
+	void assign(size_t newCount, const T& value)
+	{
+		storage.assign(newCount, value);
+		items = storage.data();
+		count = newCount;
+	}
+
+	// Views count elements at data, which must outlive the array or the next assign()/view().
+	void view(const T* data, size_t newCount)
+	{
+		storage.clear();
+		items = const_cast<T*>(data);
+		count = newCount;
+	}
+
+	bool owned() const { return items == storage.data(); }
+	size_t size() const { return count; }
+	const T* data() const { return items; }
+	const T* begin() const { return items; }
+	const T* end() const { return items + count; }
+	T& operator[](size_t i) { return items[i]; }
+	const T& operator[](size_t i) const { return items[i]; }
+
+	std::vector<T> storage;
+	T* items = nullptr;
+	size_t count = 0;
+};
+
+// ACTION TABLE: Compiled masks of an action set laid out as parallel arrays,
+// so the applicability test for a whole block of actions is a handful of
+// vector instructions instead of one pointer chase per action.
+// Arrays are padded to a multiple of kActionTableLanes with actions that never apply.
+struct ActionTable
+{
+	ActionTableArray<bitset_t> preMask;
+	ActionTableArray<bitset_t> preValue;
+	ActionTableArray<bitset_t> effSet;
+	ActionTableArray<bitset_t> effClear;
+	ActionTableArray<float> cost;
+	std::vector<Action*> actions; // Unpadded, indexed like the arrays above
+
+	// Hash of every mask and cost. Data derived from an action set (heuristic tables,
+	// caches) is keyed on it, so editing an action or its cost invalidates that data.
+	uint64_t signature = 0;
+};
+
+constexpr size_t kActionTableLanes = 4;
+
+// Actions tested per ActionTableScan call, one bit each in the returned mask.
+constexpr size_t kActionTableBlock = 64;
+
+inline size_t ActionTableSize(const ActionTable& table)
+{
+	return table.actions.size();
+}
+
+// Recomputes table.signature. Call after editing the arrays of a built table.
+inline void ActionTableUpdateSignature(ActionTable& table)
+{
+	const size_t count = ActionTableSize(table);
+	uint64_t signature = StateHashMix(count);
+	for (size_t i = 0; i < count; ++i)
+	{
+		signature = StateHashMix(signature ^ BitsetHash(table.preMask[i]));
+		signature = StateHashMix(signature ^ BitsetHash(table.preValue[i]));
+		signature = StateHashMix(signature ^ BitsetHash(table.effSet[i]));
+		signature = StateHashMix(signature ^ BitsetHash(table.effClear[i]));
+		signature = StateHashMix(signature ^ static_cast<uint64_t>(static_cast<int64_t>(table.cost[i])));
+	}
+	table.signature = signature;
+}
+
+// Rebuilds table from actions, which must be finalized. Reuses the table's memory.
+inline void ActionTableBuild(ActionTable& table, const std::vector<Action*>& actions)
+{
+	const size_t count = actions.size();
+	const size_t padded = (count + kActionTableLanes - 1) / kActionTableLanes * kActionTableLanes;
+
+	table.actions.assign(actions.begin(), actions.end());
+
+	// Padding lanes care about nothing yet require a set bit, so they never match.
+	bitset_t never;
+	BitsetInit(never);
+	BitsetSet(never, EKeyAtom::Empty);
+
+	table.preMask.assign(padded, bitset_t{});
+	table.preValue.assign(padded, never);
+	table.effSet.assign(padded, bitset_t{});
+	table.effClear.assign(padded, bitset_t{});
+	table.cost.assign(padded, 0.0f);
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		const Action& action = *actions[i];
+		assert(action.finalized && "ActionFinalize must be called before building an ActionTable");
+
+		table.preMask[i] = action.preMask;
+		table.preValue[i] = action.preValue;
+		table.effSet[i] = action.effSet;
+		table.effClear[i] = action.effClear;
+		table.cost[i] = static_cast<float>(action.cost);
+	}
+
+	ActionTableUpdateSignature(table);
+}
+
+// Tests actions [first, first + kActionTableBlock) against state. Returns a mask with bit j set
+// when action first + j is applicable, and writes its successor state to outSuccessors[j].
+// outSuccessors must hold kActionTableBlock entries; entries of inapplicable actions are unspecified.
+// With one word per state four actions share an AVX2 register; wider states already
+// fill a register per mask, so their compare and apply go through the bitset operators.
+// Words is only a template parameter so the single-word path compiles away for wide states.
+template<size_t Words = kWorldStateWords>
+inline uint64_t ActionTableScan(const ActionTable& table, size_t first, const Bitset<Words>& state, Bitset<Words>* outSuccessors)
+{
+	const size_t padded = table.preMask.size();
+	const size_t last = first + kActionTableBlock < padded ? first + kActionTableBlock : padded;
+
+	uint64_t applicable = 0;
+	size_t i = first;
+
+#if defined(__AVX2__)
+	if constexpr (Words == 1)
+	{
+		const __m256i stateV = _mm256_set1_epi64x(static_cast<long long>(state));
+		for (; i < last; i += kActionTableLanes)
+		{
+			const __m256i preMask = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&table.preMask[i]));
+			const __m256i preValue = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&table.preValue[i]));
+			const __m256i effSet = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&table.effSet[i]));
+			const __m256i effClear = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&table.effClear[i]));
+
+			const __m256i match = _mm256_cmpeq_epi64(_mm256_and_si256(stateV, preMask), preValue);
+			const uint64_t lanes = static_cast<uint64_t>(_mm256_movemask_pd(_mm256_castsi256_pd(match)));
+			applicable |= lanes << (i - first);
+
+			const __m256i successor = _mm256_or_si256(_mm256_andnot_si256(effClear, stateV), effSet);
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(&outSuccessors[i - first]), successor);
+		}
+	}
+#endif
+
+	for (; i < last; ++i)
+	{
+		const uint64_t match = (state & table.preMask[i]) == table.preValue[i] ? 1ull : 0ull;
+		applicable |= match << (i - first);
+		outSuccessors[i - first] = (state & ~table.effClear[i]) | table.effSet[i];
+	}
+
+	return applicable;
+}
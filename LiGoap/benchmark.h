@@ -0,0 +1,237 @@
+// Michael Adaixo - 2025
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "action_table.h"
+#include "goal.h"
+#include "planner.h"
+
+// Seeded random domain for searches far larger than the hand-written one. Actions read and write
+// 1-3 random facts; the goal asks for goalFacts random facts to be true, starting from all false.
+// factCount must stay below kBitsetBits, as bit 0 is EKeyAtom::Empty.
+struct SyntheticDomain
+{
+	std::deque<Action> storage;
+	std::vector<Action*> actions;
+	Goal goal;
+	WorldState start;
+};
+
+inline void MakeSyntheticDomain(SyntheticDomain& domain, uint32_t seed, uint32_t factCount, uint32_t actionCount, uint32_t goalFacts)
+{
+	std::mt19937 rng(seed);
+	std::uniform_int_distribution<uint32_t> fact(1, factCount);
+	std::uniform_int_distribution<uint32_t> cost(1, 5);
+	std::uniform_int_distribution<uint32_t> conditions(1, 3);
+	std::uniform_int_distribution<uint32_t> coin(0, 1);
+
+	domain.storage.clear();
+	domain.actions.clear();
+	for (uint32_t i = 0; i < actionCount; ++i)
+	{
+		domain.storage.emplace_back("Synthetic" + std::to_string(i), static_cast<int>(cost(rng)));
+		Action& action = domain.storage.back();
+		for (uint32_t count = conditions(rng); count > 0; --count)
+		{
+			ActionAddPrecondition(action, static_cast<EKeyAtom>(fact(rng)), coin(rng) == 1);
+		}
+		for (uint32_t count = conditions(rng); count > 0; --count)
+		{
+			ActionAddEffect(action, static_cast<EKeyAtom>(fact(rng)), coin(rng) == 1);
+		}
+		domain.actions.push_back(&action);
+	}
+	ActionsFinalize(domain.actions);
+
+	domain.goal = Goal("Synthetic");
+	for (uint32_t i = 0; i < goalFacts; ++i)
+	{
+		GoalAddSatisfaction(domain.goal, static_cast<EKeyAtom>(fact(rng)), true);
+	}
+	BitsetInit(domain.start.stateBits);
+}
+
+// Entries a benchmark query may extract before it is counted as exhausted, so a generated
+// domain with a huge unsolvable space cannot stall the suite.
+constexpr uint32_t kBenchmarkNodeBudget = 50000;
+
+// One workload: a goal and action set queried from a fixed list of start states.
+struct BenchmarkScenario
+{
+	std::string name;
+	const Goal* goal = nullptr;
+	const std::vector<Action*>* actions = nullptr;
+	std::vector<WorldState> starts;
+	PlanOptions options;
+	uint32_t factCount = 0;
+	uint32_t repetitions = 1; // Passes over starts
+};
+
+struct BenchmarkResult
+{
+	std::string name;
+	uint32_t factCount;
+	uint32_t actionCount;
+	uint32_t queries;
+	uint32_t found;
+	uint32_t exhausted; // Queries that hit kBenchmarkNodeBudget
+	double p50Us;
+	double p99Us;
+	double maxUs;
+	double meanUs;
+	double expandedPerPlan;
+	double generatedPerPlan;
+	uint32_t openPeak; // Largest open list over all queries
+	double allocationsPerPlan;
+};
+
+// Fills starts with count states made by writing flips random facts in [1, factCount] of base.
+inline void BenchmarkMakeStarts(std::vector<WorldState>& starts, uint32_t seed, const WorldState& base, uint32_t factCount,
+	uint32_t count, uint32_t flips)
+{
+	std::mt19937 rng(seed);
+	std::uniform_int_distribution<uint32_t> fact(1, factCount);
+
+	starts.assign(count, base);
+	for (WorldState& state : starts)
+	{
+		for (uint32_t i = 0; i < flips; ++i)
+		{
+			BitsetWrite(state.stateBits, static_cast<EKeyAtom>(fact(rng)), (rng() & 1) != 0);
+		}
+	}
+}
+
+// Nearest-rank percentile of sorted values, p in [0, 1].
+inline double BenchmarkPercentile(const std::vector<double>& sorted, double p)
+{
+	if (sorted.empty())
+	{
+		return 0.0;
+	}
+	const size_t rank = static_cast<size_t>(p * static_cast<double>(sorted.size()) + 0.999999);
+	return sorted[std::min(sorted.size(), std::max<size_t>(rank, 1)) - 1];
+}
+
+// Plans every query of scenario with a warmed-up context, timing each call on its own.
+// allocationCount is read before and after the timed loop, so pass a counter every allocation bumps.
+template<typename TContext>
+inline BenchmarkResult BenchmarkRunScenario(const BenchmarkScenario& scenario, const std::atomic<size_t>& allocationCount)
+{
+	using clock = std::chrono::steady_clock;
+
+	ActionTable table;
+	ActionTableBuild(table, *scenario.actions);
+
+	const size_t queryCount = scenario.starts.size() * scenario.repetitions;
+	std::vector<double> latencies;
+	latencies.reserve(queryCount);
+
+	// Warm up so the context's buffers reach their working size before anything is measured.
+	TContext context;
+	for (const WorldState& start : scenario.starts)
+	{
+		if (PlanStart(context, *scenario.goal, start, table, scenario.options) == EPlanStatus::InProgress)
+		{
+			PlanStep(context, kBenchmarkNodeBudget);
+		}
+	}
+
+	BenchmarkResult result = {};
+	result.name = scenario.name;
+	result.factCount = scenario.factCount;
+	result.actionCount = static_cast<uint32_t>(scenario.actions->size());
+
+	uint64_t expanded = 0;
+	uint64_t generated = 0;
+	const size_t allocationsBefore = allocationCount.load(std::memory_order_relaxed);
+	for (uint32_t repetition = 0; repetition < scenario.repetitions; ++repetition)
+	{
+		for (const WorldState& start : scenario.starts)
+		{
+			const auto begin = clock::now();
+			EPlanStatus status = PlanStart(context, *scenario.goal, start, table, scenario.options);
+			if (status == EPlanStatus::InProgress)
+			{
+				status = PlanStep(context, kBenchmarkNodeBudget);
+			}
+			const std::chrono::duration<double, std::micro> latency = clock::now() - begin;
+
+			latencies.push_back(latency.count());
+			result.found += status == EPlanStatus::Found ? 1 : 0;
+			result.exhausted += status == EPlanStatus::InProgress ? 1 : 0;
+			expanded += context.stats.expanded;
+			generated += context.stats.generated;
+			result.openPeak = std::max(result.openPeak, context.stats.openPeak);
+		}
+	}
+	const size_t allocations = allocationCount.load(std::memory_order_relaxed) - allocationsBefore;
+
+	double total = 0.0;
+	for (const double latency : latencies)
+	{
+		total += latency;
+	}
+	std::sort(latencies.begin(), latencies.end());
+
+	const double queries = static_cast<double>(std::max<size_t>(queryCount, 1));
+	result.queries = static_cast<uint32_t>(queryCount);
+	result.p50Us = BenchmarkPercentile(latencies, 0.50);
+	result.p99Us = BenchmarkPercentile(latencies, 0.99);
+	result.maxUs = latencies.empty() ? 0.0 : latencies.back();
+	result.meanUs = total / queries;
+	result.expandedPerPlan = static_cast<double>(expanded) / queries;
+	result.generatedPerPlan = static_cast<double>(generated) / queries;
+	result.allocationsPerPlan = static_cast<double>(allocations) / queries;
+	return result;
+}
+
+inline void BenchmarkPrintResults(const std::vector<BenchmarkResult>& results)
+{
+	printf("%-28s %5s %7s %7s %6s %5s %10s %10s %10s %10s %10s %8s %8s\n",
+		"Scenario", "Facts", "Actions", "Queries", "Found", "Exh.", "p50 us", "p99 us", "max us",
+		"Expanded", "Generated", "OpenPeak", "Allocs");
+	for (const BenchmarkResult& result : results)
+	{
+		printf("%-28s %5u %7u %7u %6u %5u %10.2f %10.2f %10.2f %10.1f %10.1f %8u %8.2f\n",
+			result.name.c_str(), result.factCount, result.actionCount, result.queries, result.found, result.exhausted,
+			result.p50Us, result.p99Us, result.maxUs, result.expandedPerPlan, result.generatedPerPlan,
+			result.openPeak, result.allocationsPerPlan);
+	}
+}
+
+// Writes results as a JSON document for regression tracking. Scenario names must not need escaping.
+inline bool BenchmarkWriteJson(const char* path, const std::vector<BenchmarkResult>& results, uint32_t seed)
+{
+	FILE* out = std::fopen(path, "w");
+	if (out == nullptr)
+	{
+		return false;
+	}
+
+	fprintf(out, "{\n  \"seed\": %u,\n  \"nodeBudget\": %u,\n  \"scenarios\": [\n", seed, kBenchmarkNodeBudget);
+	for (size_t i = 0; i < results.size(); ++i)
+	{
+		const BenchmarkResult& result = results[i];
+		fprintf(out,
+			"    { \"name\": \"%s\", \"facts\": %u, \"actions\": %u, \"queries\": %u, \"found\": %u, \"exhausted\": %u,"
+			" \"p50Us\": %.3f, \"p99Us\": %.3f, \"maxUs\": %.3f, \"meanUs\": %.3f,"
+			" \"expandedPerPlan\": %.3f, \"generatedPerPlan\": %.3f, \"openPeak\": %u, \"allocationsPerPlan\": %.3f }%s\n",
+			result.name.c_str(), result.factCount, result.actionCount, result.queries, result.found, result.exhausted,
+			result.p50Us, result.p99Us, result.maxUs, result.meanUs,
+			result.expandedPerPlan, result.generatedPerPlan, result.openPeak, result.allocationsPerPlan,
+			i + 1 < results.size() ? "," : "");
+	}
+	fprintf(out, "  ]\n}\n");
+	return std::fclose(out) == 0;
+}
@@ -1,6 +1,8 @@
 #pragma once
 
+#include <cstdint>
 #include <iostream>
+#include <stdexcept>
 #include <vector>
 #include <queue>
 #include <set>
@@ -11,6 +13,8 @@
 template<typename T>
 class BinaryHeap {
 public:
+	static constexpr bool kSupportsDecreaseKey = false;
+
 	BinaryHeap(int reserveSpace) 
 	{
 		heap.reserve(reserveSpace);
@@ -56,6 +60,10 @@ public:
 
 	bool empty() const { return heap.empty(); }
 	size_t size() const { return heap.size(); }
+	size_t capacity() const { return heap.capacity(); }
+
+	// Keeps the reserved storage so the heap can be reused without allocating.
+	void clear() { heap.clear(); }
 
 	void printHeap() const {
 		std::cout << "Heap Array: [";
@@ -87,24 +95,30 @@ private:
 
 	void heapifyDown(int index)
 	{
-		int minIndex = index;
-		int left = leftChild(index);
-		int right = rightChild(index);
-
-		if (left < heap.size() && heap[left] < heap[minIndex])
+		const int count = static_cast<int>(heap.size());
+		while (true)
 		{
-			minIndex = left;
-		}
+			int minIndex = index;
+			int left = leftChild(index);
+			int right = rightChild(index);
 
-		if (right < heap.size() && heap[right] < heap[minIndex])
-		{
-			minIndex = right;
-		}
+			if (left < count && heap[left] < heap[minIndex])
+			{
+				minIndex = left;
+			}
+
+			if (right < count && heap[right] < heap[minIndex])
+			{
+				minIndex = right;
+			}
+
+			if (index == minIndex)
+			{
+				break;
+			}
 
-		if (index != minIndex)
-		{
 			std::swap(heap[index], heap[minIndex]);
-			heapifyDown(minIndex);
+			index = minIndex;
 		}
 	}
 
@@ -148,4 +162,162 @@ private:
 
 private:
 	std::vector<T> heap;
-};
\ No newline at end of file
+};
+
+// Indexed d-ary min heap with decrease-key. Every entry is identified by a
+// handle (T::node), and the heap tracks the slot of each handle so a handle
+// has at most one live entry: inserting a handle that is already queued
+// updates it in place when the new value is smaller. With Arity 4 the
+// children of a slot are contiguous and usually share a cache line.
+template<typename T, int Arity = 4>
+class IndexedDaryHeap {
+public:
+	static constexpr bool kSupportsDecreaseKey = true;
+
+	IndexedDaryHeap(int reserveSpace)
+	{
+		heap.reserve(reserveSpace);
+		slots.reserve(reserveSpace);
+	}
+
+	// Inserts value, or decreases the key of the entry with the same handle.
+	void insert(const T& value)
+	{
+		const uint32_t handle = value.node;
+		if (handle >= slots.size())
+		{
+			slots.resize(handle + 1, kNotQueued);
+		}
+
+		const uint32_t slot = slots[handle];
+		if (slot != kNotQueued)
+		{
+			decreaseKey(value);
+			return;
+		}
+
+		heap.push_back(value);
+		slots[handle] = static_cast<uint32_t>(heap.size() - 1);
+		heapifyUp(heap.size() - 1);
+	}
+
+	// Replaces the queued entry of value's handle if value is smaller.
+	void decreaseKey(const T& value)
+	{
+		const uint32_t slot = slots[value.node];
+		if (value < heap[slot])
+		{
+			heap[slot] = value;
+			heapifyUp(slot);
+		}
+	}
+
+	bool contains(uint32_t handle) const { return handle < slots.size() && slots[handle] != kNotQueued; }
+
+	[[nodiscard]] T extractMin()
+	{
+		if (heap.empty())
+		{
+			throw std::runtime_error("Heap is empty");
+		}
+
+		T minVal = heap[0];
+		slots[minVal.node] = kNotQueued;
+
+		heap[0] = heap.back();
+		heap.pop_back();
+
+		if (!heap.empty())
+		{
+			slots[heap[0].node] = 0;
+			heapifyDown(0);
+		}
+
+		return minVal;
+	}
+
+	[[nodiscard]] T getMin() const
+	{
+		if (heap.empty())
+		{
+			throw std::runtime_error("Heap is empty");
+		}
+
+		return heap[0];
+	}
+
+	bool empty() const { return heap.empty(); }
+	size_t size() const { return heap.size(); }
+	size_t capacity() const { return heap.capacity() + slots.capacity(); }
+
+	// Keeps the reserved storage so the heap can be reused without allocating.
+	void clear()
+	{
+		for (const T& value : heap)
+		{
+			slots[value.node] = kNotQueued;
+		}
+		heap.clear();
+	}
+
+private:
+	static constexpr uint32_t kNotQueued = UINT32_MAX;
+
+	void place(size_t index, const T& value)
+	{
+		heap[index] = value;
+		slots[value.node] = static_cast<uint32_t>(index);
+	}
+
+	void heapifyUp(size_t index)
+	{
+		const T value = heap[index];
+		while (index > 0)
+		{
+			const size_t parent = (index - 1) / Arity;
+			if (!(value < heap[parent]))
+			{
+				break;
+			}
+			place(index, heap[parent]);
+			index = parent;
+		}
+		place(index, value);
+	}
+
+	void heapifyDown(size_t index)
+	{
+		const T value = heap[index];
+		const size_t count = heap.size();
+		while (true)
+		{
+			const size_t first = index * Arity + 1;
+			if (first >= count)
+			{
+				break;
+			}
+
+			const size_t last = first + Arity < count ? first + Arity : count;
+			size_t minChild = first;
+			for (size_t child = first + 1; child < last; ++child)
+			{
+				if (heap[child] < heap[minChild])
+				{
+					minChild = child;
+				}
+			}
+
+			if (!(heap[minChild] < value))
+			{
+				break;
+			}
+			place(index, heap[minChild]);
+			index = minChild;
+		}
+		place(index, value);
+	}
+
+private:
+	std::vector<T> heap;
+	std::vector<uint32_t> slots; // Heap slot per handle, kNotQueued when absent
+};
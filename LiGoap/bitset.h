@@ -2,10 +2,177 @@
 
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <type_traits>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define LIGOAP_SSE2 1
+#endif
+
 #include "types.h"
 
 using bitset64_t = uint64_t;
 
+// Bitset spanning Words 64-bit words, for domains with more than 64 facts.
+// Supports the same operators as a plain uint64_t, so masked compare
+// ((state & mask) == value) and apply ((state & ~clear) | set) read the same at every width.
+template<size_t Words>
+struct BitsetWords
+{
+	static_assert(Words > 1, "Use bitset64_t for a single word");
+
+	uint64_t words[Words];
+};
+
+namespace BitsetDetail
+{
+	template<size_t Words, typename F>
+	inline BitsetWords<Words> Combine(const BitsetWords<Words>& a, const BitsetWords<Words>& b, F op)
+	{
+		BitsetWords<Words> result;
+		for (size_t i = 0; i < Words; ++i)
+		{
+			result.words[i] = op(a.words[i], b.words[i]);
+		}
+		return result;
+	}
+}
+
+template<size_t Words>
+inline BitsetWords<Words> operator&(const BitsetWords<Words>& a, const BitsetWords<Words>& b)
+{
+	return BitsetDetail::Combine(a, b, [](uint64_t x, uint64_t y) { return x & y; });
+}
+
+template<size_t Words>
+inline BitsetWords<Words> operator|(const BitsetWords<Words>& a, const BitsetWords<Words>& b)
+{
+	return BitsetDetail::Combine(a, b, [](uint64_t x, uint64_t y) { return x | y; });
+}
+
+template<size_t Words>
+inline BitsetWords<Words> operator^(const BitsetWords<Words>& a, const BitsetWords<Words>& b)
+{
+	return BitsetDetail::Combine(a, b, [](uint64_t x, uint64_t y) { return x ^ y; });
+}
+
+template<size_t Words>
+inline BitsetWords<Words> operator~(const BitsetWords<Words>& a)
+{
+	BitsetWords<Words> result;
+	for (size_t i = 0; i < Words; ++i)
+	{
+		result.words[i] = ~a.words[i];
+	}
+	return result;
+}
+
+template<size_t Words>
+inline bool operator==(const BitsetWords<Words>& a, const BitsetWords<Words>& b)
+{
+	uint64_t diff = 0;
+	for (size_t i = 0; i < Words; ++i)
+	{
+		diff |= a.words[i] ^ b.words[i];
+	}
+	return diff == 0;
+}
+
+// Two and four word variants map onto one SSE2 / AVX2 register.
+#if defined(LIGOAP_SSE2) || defined(__AVX2__)
+inline __m128i BitsetLoad(const BitsetWords<2>& a) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(a.words)); }
+inline BitsetWords<2> BitsetStore(__m128i v) { BitsetWords<2> r; _mm_storeu_si128(reinterpret_cast<__m128i*>(r.words), v); return r; }
+
+inline BitsetWords<2> operator&(const BitsetWords<2>& a, const BitsetWords<2>& b) { return BitsetStore(_mm_and_si128(BitsetLoad(a), BitsetLoad(b))); }
+inline BitsetWords<2> operator|(const BitsetWords<2>& a, const BitsetWords<2>& b) { return BitsetStore(_mm_or_si128(BitsetLoad(a), BitsetLoad(b))); }
+inline BitsetWords<2> operator^(const BitsetWords<2>& a, const BitsetWords<2>& b) { return BitsetStore(_mm_xor_si128(BitsetLoad(a), BitsetLoad(b))); }
+inline bool operator==(const BitsetWords<2>& a, const BitsetWords<2>& b)
+{
+	return _mm_movemask_epi8(_mm_cmpeq_epi8(BitsetLoad(a), BitsetLoad(b))) == 0xFFFF;
+}
+#endif
+
+#if defined(__AVX2__)
+inline __m256i BitsetLoad(const BitsetWords<4>& a) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a.words)); }
+inline BitsetWords<4> BitsetStore(__m256i v) { BitsetWords<4> r; _mm256_storeu_si256(reinterpret_cast<__m256i*>(r.words), v); return r; }
+
+inline BitsetWords<4> operator&(const BitsetWords<4>& a, const BitsetWords<4>& b) { return BitsetStore(_mm256_and_si256(BitsetLoad(a), BitsetLoad(b))); }
+inline BitsetWords<4> operator|(const BitsetWords<4>& a, const BitsetWords<4>& b) { return BitsetStore(_mm256_or_si256(BitsetLoad(a), BitsetLoad(b))); }
+inline BitsetWords<4> operator^(const BitsetWords<4>& a, const BitsetWords<4>& b) { return BitsetStore(_mm256_xor_si256(BitsetLoad(a), BitsetLoad(b))); }
+inline bool operator==(const BitsetWords<4>& a, const BitsetWords<4>& b)
+{
+	return _mm256_movemask_epi8(_mm256_cmpeq_epi8(BitsetLoad(a), BitsetLoad(b))) == -1;
+}
+#endif
+
+template<size_t Words>
+inline bool operator!=(const BitsetWords<Words>& a, const BitsetWords<Words>& b)
+{
+	return !(a == b);
+}
+
+template<size_t Words>
+inline BitsetWords<Words>& operator&=(BitsetWords<Words>& a, const BitsetWords<Words>& b) { return a = a & b; }
+
+template<size_t Words>
+inline BitsetWords<Words>& operator|=(BitsetWords<Words>& a, const BitsetWords<Words>& b) { return a = a | b; }
+
+// Bitset type for a width in words: a plain uint64_t for one word, so the
+// common 64-fact case compiles to exactly the single-register code.
+template<size_t Words>
+using Bitset = std::conditional_t<Words == 1, bitset64_t, BitsetWords<Words>>;
+
+constexpr size_t BitsetWordsForKeys(size_t keyCount)
+{
+	// Round up to 1, 2, 4 or 8 words so wide states stay register sized.
+	size_t words = 1;
+	while (words * 64 < keyCount)
+	{
+		words *= 2;
+	}
+	return words;
+}
+
+// Width of every WorldState and action mask. Derived from EKeyAtom::Count; define
+// LIGOAP_WORLD_STATE_WORDS to force a wider layout.
+#if defined(LIGOAP_WORLD_STATE_WORDS)
+constexpr size_t kWorldStateWords = LIGOAP_WORLD_STATE_WORDS;
+#else
+constexpr size_t kWorldStateWords = BitsetWordsForKeys(static_cast<size_t>(EKeyAtom::Count));
+#endif
+
+static_assert(static_cast<size_t>(EKeyAtom::Count) <= kWorldStateWords * 64,
+	"EKeyAtom has more keys than kWorldStateWords can hold");
+static_assert(kWorldStateWords == 1 || kWorldStateWords == 2 || kWorldStateWords == 4 || kWorldStateWords == 8,
+	"kWorldStateWords must be 1, 2, 4 or 8");
+
+using bitset_t = Bitset<kWorldStateWords>;
+
+constexpr size_t kBitsetBits = kWorldStateWords * 64;
+
+// Finalizer from splitmix64. States are sparse bit patterns, so the identity
+// hash clusters badly in an open-addressing table; this spreads every input bit.
+inline uint64_t StateHashMix(uint64_t x)
+{
+	x ^= x >> 30;
+	x *= 0xbf58476d1ce4e5b9ull;
+	x ^= x >> 27;
+	x *= 0x94d049bb133111ebull;
+	x ^= x >> 31;
+	return x;
+}
+
+// Single word
+
 inline void BitsetInit(bitset64_t& bitset)
 {
 	bitset = 0;
@@ -46,7 +213,7 @@ inline bool BitsetRead(bitset64_t bitset, EKeyAtom key)
 inline void BitsetPrint(bitset64_t bitset)
 {
 	printf("64th Key |--- ---| 0th Key\n");
-	
+
 	// Print the bits from most significant to the least significant
 	for (int i = 63; i >= 0; i--) {
 		printf("%d", (bitset & (1ULL << i)) ? 1 : 0);
@@ -56,3 +223,153 @@ inline void BitsetPrint(bitset64_t bitset)
 	}
 	printf("\n");
 }
+
+// Index of the lowest set bit. bitset must not be zero.
+inline uint32_t BitsetLowestBit(bitset64_t bitset)
+{
+#if defined(_MSC_VER)
+	unsigned long index;
+	_BitScanForward64(&index, bitset);
+	return static_cast<uint32_t>(index);
+#else
+	return static_cast<uint32_t>(__builtin_ctzll(bitset));
+#endif
+}
+
+// Number of set bits.
+inline uint32_t BitsetCount(bitset64_t bitset)
+{
+#if defined(_MSC_VER)
+	return static_cast<uint32_t>(__popcnt64(bitset));
+#else
+	return static_cast<uint32_t>(__builtin_popcountll(bitset));
+#endif
+}
+
+inline bool BitsetAny(bitset64_t bitset)
+{
+	return bitset != 0;
+}
+
+inline bool BitsetTest(bitset64_t bitset, uint32_t bit)
+{
+	return ((bitset >> bit) & 1ull) != 0;
+}
+
+inline uint64_t BitsetHash(bitset64_t bitset)
+{
+	return StateHashMix(bitset);
+}
+
+// Calls fn(bit) for every set bit, lowest first.
+template<typename F>
+inline void BitsetForEach(bitset64_t bitset, F&& fn)
+{
+	while (bitset != 0)
+	{
+		fn(BitsetLowestBit(bitset));
+		bitset &= bitset - 1;
+	}
+}
+
+// Multiple words
+
+template<size_t Words>
+inline void BitsetInit(BitsetWords<Words>& bitset)
+{
+	bitset = {};
+}
+
+template<size_t Words>
+inline void BitsetSet(BitsetWords<Words>& bitset, EKeyAtom key)
+{
+	const uint64_t bit = static_cast<uint64_t>(key);
+	bitset.words[bit / 64] |= (1ull << (bit % 64));
+}
+
+template<size_t Words>
+inline void BitsetClear(BitsetWords<Words>& bitset, EKeyAtom key)
+{
+	const uint64_t bit = static_cast<uint64_t>(key);
+	bitset.words[bit / 64] &= ~(1ull << (bit % 64));
+}
+
+template<size_t Words>
+inline void BitsetCombine(BitsetWords<Words>& inOutBitset, const BitsetWords<Words>& bitset)
+{
+	inOutBitset |= bitset;
+}
+
+template<size_t Words>
+inline void BitsetWrite(BitsetWords<Words>& bitset, EKeyAtom key, bool value)
+{
+	if (value)
+	{
+		BitsetSet(bitset, key);
+	}
+	else
+	{
+		BitsetClear(bitset, key);
+	}
+}
+
+template<size_t Words>
+inline bool BitsetRead(const BitsetWords<Words>& bitset, EKeyAtom key)
+{
+	const uint64_t bit = static_cast<uint64_t>(key);
+	return (bitset.words[bit / 64] & (1ull << (bit % 64))) != 0;
+}
+
+template<size_t Words>
+inline void BitsetPrint(const BitsetWords<Words>& bitset)
+{
+	for (size_t i = Words; i-- > 0;)
+	{
+		BitsetPrint(bitset.words[i]);
+	}
+}
+
+template<size_t Words>
+inline uint32_t BitsetCount(const BitsetWords<Words>& bitset)
+{
+	uint32_t count = 0;
+	for (size_t i = 0; i < Words; ++i)
+	{
+		count += BitsetCount(bitset.words[i]);
+	}
+	return count;
+}
+
+template<size_t Words>
+inline bool BitsetAny(const BitsetWords<Words>& bitset)
+{
+	return !(bitset == BitsetWords<Words>{});
+}
+
+template<size_t Words>
+inline bool BitsetTest(const BitsetWords<Words>& bitset, uint32_t bit)
+{
+	return BitsetTest(bitset.words[bit / 64], bit % 64);
+}
+
+template<size_t Words, typename F>
+inline void BitsetForEach(const BitsetWords<Words>& bitset, F&& fn)
+{
+	for (size_t i = 0; i < Words; ++i)
+	{
+		const uint32_t base = static_cast<uint32_t>(i * 64);
+		BitsetForEach(bitset.words[i], [&](uint32_t bit) { fn(base + bit); });
+	}
+}
+
+template<size_t Words>
+inline uint64_t BitsetHash(const BitsetWords<Words>& bitset)
+{
+	// 64-bit multiplies have no SSE2/AVX2 form, so words are folded one at a time.
+	uint64_t hash = StateHashMix(bitset.words[0]);
+	for (size_t i = 1; i < Words; ++i)
+	{
+		hash = StateHashMix(hash ^ bitset.words[i]);
+	}
+	return hash;
+}
@@ -0,0 +1,143 @@
+// Michael Adaixo - 2025
+
+#pragma once
+
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+// Open list for searches where f and h are small non-negative integers,
+// which is always the case with integer action costs and a counting heuristic.
+// Entries are bucketed by f, then by h, so insert is O(1) and extractMin is
+// amortised O(1): the cursor only scans forward until something is inserted below it.
+// Ties on f prefer lower h; ties on both pop the most recently inserted entry.
+// T must expose integral valued f and h members.
+template<typename T>
+class BucketQueue {
+public:
+	static constexpr bool kSupportsDecreaseKey = false;
+
+	BucketQueue(int reserveSpace)
+	{
+		buckets.reserve(reserveSpace);
+	}
+
+	void insert(const T& value)
+	{
+		assert(value.f >= 0.0f && std::floor(value.f) == value.f && "BucketQueue needs integer f");
+		assert(value.h >= 0.0f && std::floor(value.h) == value.h && "BucketQueue needs integer h");
+
+		const size_t f = static_cast<size_t>(value.f);
+		const size_t h = static_cast<size_t>(value.h);
+
+		if (f >= buckets.size())
+		{
+			buckets.resize(f + 1);
+		}
+
+		Bucket& bucket = buckets[f];
+		if (h >= bucket.byH.size())
+		{
+			bucket.byH.resize(h + 1);
+		}
+
+		std::vector<T>& stack = bucket.byH[h];
+		const size_t oldCapacity = stack.capacity();
+		stack.push_back(value);
+		reserved += stack.capacity() - oldCapacity;
+
+		bucket.count++;
+		bucket.minH = h < bucket.minH ? h : bucket.minH;
+		minF = f < minF ? f : minF;
+		maxF = f > maxF ? f : maxF;
+		count++;
+	}
+
+	[[nodiscard]] T extractMin()
+	{
+		if (count == 0)
+		{
+			throw std::runtime_error("Queue is empty");
+		}
+
+		Bucket& bucket = advanceToMin();
+		std::vector<T>& stack = bucket.byH[bucket.minH];
+
+		T minVal = stack.back();
+		stack.pop_back();
+		bucket.count--;
+		count--;
+
+		return minVal;
+	}
+
+	[[nodiscard]] T getMin()
+	{
+		if (count == 0)
+		{
+			throw std::runtime_error("Queue is empty");
+		}
+
+		Bucket& bucket = advanceToMin();
+		return bucket.byH[bucket.minH].back();
+	}
+
+	bool empty() const { return count == 0; }
+	size_t size() const { return count; }
+	size_t capacity() const { return reserved + buckets.capacity(); }
+
+	// Keeps the reserved storage so the queue can be reused without allocating.
+	void clear()
+	{
+		if (maxF >= minF)
+		{
+			for (size_t f = minF; f <= maxF && f < buckets.size(); ++f)
+			{
+				Bucket& bucket = buckets[f];
+				for (std::vector<T>& stack : bucket.byH)
+				{
+					stack.clear();
+				}
+				bucket.count = 0;
+				bucket.minH = SIZE_MAX;
+			}
+		}
+
+		count = 0;
+		minF = SIZE_MAX;
+		maxF = 0;
+	}
+
+private:
+	struct Bucket
+	{
+		std::vector<std::vector<T>> byH;
+		size_t count = 0;
+		size_t minH = SIZE_MAX; // Lower bound on the smallest non-empty h
+	};
+
+	Bucket& advanceToMin()
+	{
+		while (buckets[minF].count == 0)
+		{
+			buckets[minF].minH = SIZE_MAX;
+			minF++;
+		}
+
+		Bucket& bucket = buckets[minF];
+		while (bucket.byH[bucket.minH].empty())
+		{
+			bucket.minH++;
+		}
+		return bucket;
+	}
+
+private:
+	std::vector<Bucket> buckets;
+	size_t count = 0;
+	size_t minF = SIZE_MAX; // Lower bound on the smallest non-empty f
+	size_t maxF = 0;
+	size_t reserved = 0;
+};
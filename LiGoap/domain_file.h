@@ -0,0 +1,604 @@
+// Michael Adaixo - 2025
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "action.h"
+#include "action_table.h"
+#include "goal.h"
+#include "mapped_file.h"
+
+// DOMAIN FILE: Compiled action sets and goals in one file the planner can use straight from a
+// read-only mapping. The file holds the ActionTable arrays as they sit in memory, so loading one is
+// a map plus a validation pass: the table views the mapped pages, which the OS shares between every
+// process mapping the same file. Names and fact ids go through a string table.
+constexpr uint32_t kDomainFileVersion = 1;
+constexpr char kDomainFileMagic[4] = { 'L', 'G', 'D', 'M' };
+constexpr uint64_t kDomainFileAlignment = 32; // Every section starts on an AVX2 register boundary
+
+// File layout: header, then the sections at the offsets it gives. Values are stored in native
+// byte order; a file is only meant to be read on the platform that wrote it.
+struct DomainFileHeader
+{
+	char magic[4];
+	uint32_t version;
+	uint32_t stateWords; // kWorldStateWords of the writer
+	uint32_t actionCount;
+	uint32_t paddedCount; // actionCount rounded up to kActionTableLanes, the length of the table arrays
+	uint32_t goalCount;
+	uint32_t factCount;
+	uint32_t stringBytes;
+	uint64_t actionSignature; // ActionTable signature of the actions
+	uint64_t fileSize;
+
+	// Byte offsets from the start of the file
+	uint64_t preMask;  // paddedCount bitset_t, then preValue, effSet, effClear alike
+	uint64_t preValue;
+	uint64_t effSet;
+	uint64_t effClear;
+	uint64_t cost;     // paddedCount float
+	uint64_t actions;  // actionCount DomainFileAction
+	uint64_t goals;    // goalCount DomainFileGoal
+	uint64_t facts;    // factCount DomainFileFact
+	uint64_t strings;  // stringBytes of NUL-terminated names
+};
+
+struct DomainFileAction
+{
+	uint32_t name; // Offset in the string table
+	int32_t cost;
+};
+
+struct DomainFileGoal
+{
+	bitset_t care;
+	bitset_t value;
+	uint32_t name;
+	uint32_t padding;
+};
+
+// Every fact the masks use, with the EKeyAtom name it had when the file was written.
+struct DomainFileFact
+{
+	uint32_t name;
+	uint32_t bit;
+};
+
+struct DomainFile : NoCopy
+{
+	// Views into the file image, which lives in storage after a build or in file after a load
+	const DomainFileHeader* header = nullptr;
+	const DomainFileAction* fileActions = nullptr;
+	const DomainFileGoal* fileGoals = nullptr;
+	const DomainFileFact* fileFacts = nullptr;
+	const char* strings = nullptr;
+
+	std::vector<uint8_t> storage;
+	MappedFile file;
+
+	// Planner-facing side. The table's arrays view the image. Plans point into actions, which are
+	// compiled-only records allocated as one array: their pre/eff maps and names are left empty,
+	// see DomainActionName().
+	ActionTable table;
+	std::unique_ptr<Action[]> actions;
+};
+
+inline bool DomainValid(const DomainFile& domain)
+{
+	return domain.header != nullptr;
+}
+
+inline uint64_t DomainAlign(uint64_t offset)
+{
+	return (offset + kDomainFileAlignment - 1) / kDomainFileAlignment * kDomainFileAlignment;
+}
+
+// Finds the EKeyAtom called name. Returns false when no fact has that name.
+inline bool KeyAtomFromName(const char* name, EKeyAtom& outKey)
+{
+	for (size_t i = 0; i < static_cast<size_t>(EKeyAtom::Count); ++i)
+	{
+		if (std::strcmp(kKeyAtomNames[i], name) == 0)
+		{
+			outKey = static_cast<EKeyAtom>(i);
+			return true;
+		}
+	}
+	return false;
+}
+
+// Points the views at image and builds the planner-facing side. image must hold a validated file image.
+// Returns false when the signature recomputed from the viewed arrays differs from the header's.
+inline bool DomainAttach(DomainFile& domain, const uint8_t* image)
+{
+	const DomainFileHeader* header = reinterpret_cast<const DomainFileHeader*>(image);
+	domain.header = header;
+	domain.fileActions = reinterpret_cast<const DomainFileAction*>(image + header->actions);
+	domain.fileGoals = reinterpret_cast<const DomainFileGoal*>(image + header->goals);
+	domain.fileFacts = reinterpret_cast<const DomainFileFact*>(image + header->facts);
+	domain.strings = reinterpret_cast<const char*>(image + header->strings);
+
+	ActionTable& table = domain.table;
+	table.preMask.view(reinterpret_cast<const bitset_t*>(image + header->preMask), header->paddedCount);
+	table.preValue.view(reinterpret_cast<const bitset_t*>(image + header->preValue), header->paddedCount);
+	table.effSet.view(reinterpret_cast<const bitset_t*>(image + header->effSet), header->paddedCount);
+	table.effClear.view(reinterpret_cast<const bitset_t*>(image + header->effClear), header->paddedCount);
+	table.cost.view(reinterpret_cast<const float*>(image + header->cost), header->paddedCount);
+
+	domain.actions.reset(new Action[header->actionCount]);
+	table.actions.resize(header->actionCount);
+	for (uint32_t i = 0; i < header->actionCount; ++i)
+	{
+		Action& action = domain.actions[i];
+		action.cost = static_cast<int8_t>(domain.fileActions[i].cost);
+		action.preMask = table.preMask[i];
+		action.preValue = table.preValue[i];
+		action.effSet = table.effSet[i];
+		action.effClear = table.effClear[i];
+		action.finalized = true;
+		table.actions[i] = &action;
+	}
+
+	// Never trust the stored signature: caches keyed on it would reuse results of other actions
+	ActionTableUpdateSignature(table);
+	return table.signature == header->actionSignature;
+}
+
+inline void DomainClear(DomainFile& domain)
+{
+	domain.header = nullptr;
+	domain.table = ActionTable();
+	domain.actions.reset();
+	domain.storage.clear();
+	domain.file.close();
+}
+
+// Compiles actions and goals into domain, which then plans without the originals.
+// Returns false, leaving domain empty, when a mask uses a fact kKeyAtomNames does not name.
+inline bool DomainBuild(DomainFile& domain, const std::vector<Action*>& actions, const std::vector<const Goal*>& goals)
+{
+	DomainClear(domain);
+
+	ActionTable table;
+	ActionTableBuild(table, actions);
+
+	std::vector<DomainFileGoal> fileGoals(goals.size());
+	for (size_t i = 0; i < goals.size(); ++i)
+	{
+		GoalGetMasks(*goals[i], fileGoals[i].care, fileGoals[i].value);
+	}
+
+	bitset_t used;
+	BitsetInit(used);
+	for (size_t i = 0; i < actions.size(); ++i)
+	{
+		used = used | table.preMask[i] | table.effSet[i] | table.effClear[i];
+	}
+	for (const DomainFileGoal& goal : fileGoals)
+	{
+		used = used | goal.care;
+	}
+
+	// String table: an empty name at offset 0, then action names, goal names and fact names.
+	std::string strings(1, '\0');
+	auto addString = [&strings](const std::string& name)
+	{
+		const uint32_t offset = static_cast<uint32_t>(strings.size());
+		strings.append(name.c_str(), name.size() + 1);
+		return offset;
+	};
+
+	std::vector<DomainFileAction> fileActions(actions.size());
+	for (size_t i = 0; i < actions.size(); ++i)
+	{
+		fileActions[i].name = addString(actions[i]->name);
+		fileActions[i].cost = actions[i]->cost;
+	}
+	for (size_t i = 0; i < goals.size(); ++i)
+	{
+		fileGoals[i].name = addString(goals[i]->name);
+	}
+
+	std::vector<DomainFileFact> fileFacts;
+	bool named = true;
+	BitsetForEach(used, [&](uint32_t bit)
+	{
+		named = named && bit < static_cast<uint32_t>(EKeyAtom::Count);
+		if (named)
+		{
+			fileFacts.push_back({ addString(kKeyAtomNames[bit]), bit });
+		}
+	});
+	if (!named)
+	{
+		return false;
+	}
+
+	DomainFileHeader header = {};
+	std::memcpy(header.magic, kDomainFileMagic, sizeof(header.magic));
+	header.version = kDomainFileVersion;
+	header.stateWords = static_cast<uint32_t>(kWorldStateWords);
+	header.actionCount = static_cast<uint32_t>(actions.size());
+	header.paddedCount = static_cast<uint32_t>(table.preMask.size());
+	header.goalCount = static_cast<uint32_t>(goals.size());
+	header.factCount = static_cast<uint32_t>(fileFacts.size());
+	header.stringBytes = static_cast<uint32_t>(strings.size());
+	header.actionSignature = table.signature;
+
+	const uint64_t maskBytes = header.paddedCount * sizeof(bitset_t);
+	header.preMask = DomainAlign(sizeof(DomainFileHeader));
+	header.preValue = DomainAlign(header.preMask + maskBytes);
+	header.effSet = DomainAlign(header.preValue + maskBytes);
+	header.effClear = DomainAlign(header.effSet + maskBytes);
+	header.cost = DomainAlign(header.effClear + maskBytes);
+	header.actions = DomainAlign(header.cost + header.paddedCount * sizeof(float));
+	header.goals = DomainAlign(header.actions + header.actionCount * sizeof(DomainFileAction));
+	header.facts = DomainAlign(header.goals + header.goalCount * sizeof(DomainFileGoal));
+	header.strings = DomainAlign(header.facts + header.factCount * sizeof(DomainFileFact));
+	header.fileSize = header.strings + header.stringBytes;
+
+	std::vector<uint8_t>& image = domain.storage;
+	image.assign(header.fileSize, 0);
+	auto write = [&image](uint64_t offset, const void* data, size_t bytes)
+	{
+		if (bytes > 0)
+		{
+			std::memcpy(image.data() + offset, data, bytes);
+		}
+	};
+	write(0, &header, sizeof(header));
+	write(header.preMask, table.preMask.data(), maskBytes);
+	write(header.preValue, table.preValue.data(), maskBytes);
+	write(header.effSet, table.effSet.data(), maskBytes);
+	write(header.effClear, table.effClear.data(), maskBytes);
+	write(header.cost, table.cost.data(), header.paddedCount * sizeof(float));
+	write(header.actions, fileActions.data(), fileActions.size() * sizeof(DomainFileAction));
+	write(header.goals, fileGoals.data(), fileGoals.size() * sizeof(DomainFileGoal));
+	write(header.facts, fileFacts.data(), fileFacts.size() * sizeof(DomainFileFact));
+	write(header.strings, strings.data(), strings.size());
+
+	if (!DomainAttach(domain, image.data()))
+	{
+		DomainClear(domain);
+		return false;
+	}
+	return true;
+}
+
+// Checks that image of size bytes is a domain file this build can plan with: the format matches,
+// every section and name lies inside the file, every fact still has the EKeyAtom value it was written
+// with, masks only use those facts, float costs match the action records, and padding lanes keep the
+// never-match pattern of ActionTableBuild() so the scan cannot report an action past actionCount.
+inline bool DomainValidate(const uint8_t* image, size_t size)
+{
+	if (size < sizeof(DomainFileHeader))
+	{
+		return false;
+	}
+
+	DomainFileHeader header;
+	std::memcpy(&header, image, sizeof(header));
+	if (std::memcmp(header.magic, kDomainFileMagic, sizeof(header.magic)) != 0 || header.version != kDomainFileVersion
+		|| header.stateWords != kWorldStateWords || header.fileSize != size
+		|| header.paddedCount != (header.actionCount + kActionTableLanes - 1) / kActionTableLanes * kActionTableLanes
+		|| header.stringBytes == 0)
+	{
+		return false;
+	}
+
+	const uint64_t sections[][2] = {
+		{ header.preMask, header.paddedCount * sizeof(bitset_t) },
+		{ header.preValue, header.paddedCount * sizeof(bitset_t) },
+		{ header.effSet, header.paddedCount * sizeof(bitset_t) },
+		{ header.effClear, header.paddedCount * sizeof(bitset_t) },
+		{ header.cost, header.paddedCount * sizeof(float) },
+		{ header.actions, header.actionCount * sizeof(DomainFileAction) },
+		{ header.goals, header.goalCount * sizeof(DomainFileGoal) },
+		{ header.facts, header.factCount * sizeof(DomainFileFact) },
+		{ header.strings, header.stringBytes },
+	};
+	for (const auto& section : sections)
+	{
+		if (section[0] % kDomainFileAlignment != 0 || section[0] < sizeof(DomainFileHeader) || section[0] > size || section[1] > size - section[0])
+		{
+			return false;
+		}
+	}
+
+	const char* strings = reinterpret_cast<const char*>(image + header.strings);
+	if (strings[header.stringBytes - 1] != '\0')
+	{
+		return false;
+	}
+
+	const DomainFileAction* actions = reinterpret_cast<const DomainFileAction*>(image + header.actions);
+	for (uint32_t i = 0; i < header.actionCount; ++i)
+	{
+		if (actions[i].name >= header.stringBytes || actions[i].cost < 0 || actions[i].cost > INT8_MAX)
+		{
+			return false;
+		}
+	}
+
+	bitset_t declared;
+	BitsetInit(declared);
+	const DomainFileFact* facts = reinterpret_cast<const DomainFileFact*>(image + header.facts);
+	for (uint32_t i = 0; i < header.factCount; ++i)
+	{
+		EKeyAtom key;
+		if (facts[i].name >= header.stringBytes || !KeyAtomFromName(strings + facts[i].name, key)
+			|| static_cast<uint32_t>(key) != facts[i].bit)
+		{
+			return false;
+		}
+		BitsetSet(declared, key);
+	}
+
+	const DomainFileGoal* goals = reinterpret_cast<const DomainFileGoal*>(image + header.goals);
+	for (uint32_t i = 0; i < header.goalCount; ++i)
+	{
+		if (goals[i].name >= header.stringBytes || BitsetAny(goals[i].care & ~declared) || BitsetAny(goals[i].value & ~goals[i].care))
+		{
+			return false;
+		}
+	}
+
+	const bitset_t* preMask = reinterpret_cast<const bitset_t*>(image + header.preMask);
+	const bitset_t* preValue = reinterpret_cast<const bitset_t*>(image + header.preValue);
+	const bitset_t* effSet = reinterpret_cast<const bitset_t*>(image + header.effSet);
+	const bitset_t* effClear = reinterpret_cast<const bitset_t*>(image + header.effClear);
+	const float* cost = reinterpret_cast<const float*>(image + header.cost);
+
+	bitset_t never;
+	BitsetInit(never);
+	BitsetSet(never, EKeyAtom::Empty);
+
+	for (uint32_t i = 0; i < header.paddedCount; ++i)
+	{
+		if (i >= header.actionCount)
+		{
+			if (BitsetAny(preMask[i]) || preValue[i] != never || BitsetAny(effSet[i]) || BitsetAny(effClear[i]) || cost[i] != 0.0f)
+			{
+				return false;
+			}
+			continue;
+		}
+
+		// The search reads the float cost, so it has to be the record's cost: finite, 0-127.
+		if (BitsetAny((preMask[i] | effSet[i] | effClear[i]) & ~declared) || BitsetAny(preValue[i] & ~preMask[i])
+			|| BitsetAny(effSet[i] & effClear[i]) || cost[i] != static_cast<float>(actions[i].cost))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+// Maps a domain written by DomainSave(). Returns false, leaving domain empty, when the file is
+// missing, fails DomainValidate(), or its arrays do not hash to the stored action signature.
+inline bool DomainLoad(DomainFile& domain, const char* path)
+{
+	DomainClear(domain);
+
+	if (!domain.file.open(path) || !DomainValidate(domain.file.data(), domain.file.size()))
+	{
+		domain.file.close();
+		return false;
+	}
+
+	if (!DomainAttach(domain, domain.file.data()))
+	{
+		DomainClear(domain);
+		return false;
+	}
+	return true;
+}
+
+inline bool DomainSave(const DomainFile& domain, const char* path)
+{
+	if (!DomainValid(domain))
+	{
+		return false;
+	}
+
+	FILE* out = std::fopen(path, "wb");
+	if (out == nullptr)
+	{
+		return false;
+	}
+
+	const size_t size = static_cast<size_t>(domain.header->fileSize);
+	const bool written = std::fwrite(domain.header, 1, size, out) == size;
+	return std::fclose(out) == 0 && written;
+}
+
+// Name of one of domain.actions, e.g. an entry of a plan made with domain.table.
+inline const char* DomainActionName(const DomainFile& domain, const Action* action)
+{
+	return domain.strings + domain.fileActions[action - domain.actions.get()].name;
+}
+
+// Returns the action called name, or null.
+inline const Action* DomainFindAction(const DomainFile& domain, const char* name)
+{
+	for (uint32_t i = 0; i < domain.header->actionCount; ++i)
+	{
+		if (std::strcmp(domain.strings + domain.fileActions[i].name, name) == 0)
+		{
+			return &domain.actions[i];
+		}
+	}
+	return nullptr;
+}
+
+// Rebuilds the goal called name into outGoal. Returns false when the domain has no such goal.
+inline bool DomainGetGoal(const DomainFile& domain, const char* name, Goal& outGoal)
+{
+	for (uint32_t i = 0; i < domain.header->goalCount; ++i)
+	{
+		const DomainFileGoal& goal = domain.fileGoals[i];
+		if (std::strcmp(domain.strings + goal.name, name) == 0)
+		{
+			outGoal = Goal(domain.strings + goal.name);
+			BitsetForEach(goal.care, [&](uint32_t bit)
+			{
+				GoalAddSatisfaction(outGoal, static_cast<EKeyAtom>(bit), BitsetTest(goal.value, bit));
+			});
+			return true;
+		}
+	}
+	return false;
+}
+
+// DOMAIN COMPILER: Text form of a domain, one statement per line, '#' starts a comment.
+//
+//   action <Name> <cost>    Starts an action; cost is 0-127
+//   pre [!]<fact>           Precondition of the current action: fact true, or false with '!'
+//   eff [!]<fact>           Effect of the current action: sets fact true, or false with '!'
+//   goal <Name>             Starts a goal
+//   want [!]<fact>          Satisfaction of the current goal
+//
+// Facts are EKeyAtom names as in kKeyAtomNames.
+inline bool DomainCompileText(DomainFile& domain, const std::string& text, std::string& outError)
+{
+	std::deque<Action> actionStorage;
+	std::deque<Goal> goalStorage;
+	std::vector<Action*> actions;
+	std::vector<const Goal*> goals;
+	Action* action = nullptr;
+	Goal* goal = nullptr;
+
+	std::istringstream lines(text);
+	std::string line;
+	for (uint32_t lineNumber = 1; std::getline(lines, line); ++lineNumber)
+	{
+		line = line.substr(0, line.find('#'));
+		std::istringstream words(line);
+		std::string keyword;
+		std::string name;
+		std::string extra;
+		if (!(words >> keyword))
+		{
+			continue;
+		}
+
+		auto fail = [&](const std::string& message)
+		{
+			outError = "line " + std::to_string(lineNumber) + ": " + message;
+			DomainClear(domain);
+			return false;
+		};
+
+		if (keyword == "action")
+		{
+			int cost = -1;
+			if (!(words >> name >> cost) || (words >> extra) || cost < 0 || cost > INT8_MAX)
+			{
+				return fail("expected 'action <Name> <cost>' with cost 0-127");
+			}
+			for (const Action* other : actions)
+			{
+				if (other->name == name)
+				{
+					return fail("duplicate action '" + name + "'");
+				}
+			}
+			actionStorage.emplace_back(std::move(name), cost);
+			action = &actionStorage.back();
+			actions.push_back(action);
+			goal = nullptr;
+		}
+		else if (keyword == "goal")
+		{
+			if (!(words >> name) || (words >> extra))
+			{
+				return fail("expected 'goal <Name>'");
+			}
+			goalStorage.emplace_back(name);
+			goal = &goalStorage.back();
+			goals.push_back(goal);
+			action = nullptr;
+		}
+		else if (keyword == "pre" || keyword == "eff" || keyword == "want")
+		{
+			if (!(words >> name) || (words >> extra))
+			{
+				return fail("expected '" + keyword + " [!]<fact>'");
+			}
+
+			const bool value = name[0] != '!';
+			EKeyAtom key;
+			if (!KeyAtomFromName(name.c_str() + (value ? 0 : 1), key) || key == EKeyAtom::Empty)
+			{
+				return fail("unknown fact '" + name + "'");
+			}
+
+			if (keyword == "want")
+			{
+				if (goal == nullptr)
+				{
+					return fail("'want' outside a goal");
+				}
+				GoalAddSatisfaction(*goal, key, value);
+			}
+			else if (action == nullptr)
+			{
+				return fail("'" + keyword + "' outside an action");
+			}
+			else if (keyword == "pre")
+			{
+				ActionAddPrecondition(*action, key, value);
+			}
+			else
+			{
+				ActionAddEffect(*action, key, value);
+			}
+		}
+		else
+		{
+			return fail("unknown statement '" + keyword + "'");
+		}
+	}
+
+	ActionsFinalize(actions);
+	return DomainBuild(domain, actions, goals);
+}
+
+// Compiles the text domain at inputPath and writes it to outputPath.
+inline bool DomainCompileFile(const char* inputPath, const char* outputPath, std::string& outError)
+{
+	FILE* in = std::fopen(inputPath, "rb");
+	if (in == nullptr)
+	{
+		outError = std::string("cannot open ") + inputPath;
+		return false;
+	}
+
+	std::string text;
+	char buffer[4096];
+	for (size_t read; (read = std::fread(buffer, 1, sizeof(buffer), in)) > 0; )
+	{
+		text.append(buffer, read);
+	}
+	std::fclose(in);
+
+	DomainFile domain;
+	if (!DomainCompileText(domain, text, outError))
+	{
+		return false;
+	}
+	if (!DomainSave(domain, outputPath))
+	{
+		outError = std::string("cannot write ") + outputPath;
+		return false;
+	}
+	return true;
+}
@@ -2,7 +2,10 @@
 
 #pragma once
 
-#include "types.h"
+#include <string>
+
+#include "bitset.h"
+#include "worldstate.h"
 
 // GOAL: Describes desired state
 struct Goal
@@ -30,4 +33,16 @@ inline float GoalDistanceToState(const Goal& goal, const WorldState& state)
 		}
 	}
 	return distance;
-}
\ No newline at end of file
+}
+
+// Compiles the satisfactions into a care mask and the values required under it.
+inline void GoalGetMasks(const Goal& goal, bitset_t& outCareMask, bitset_t& outValueBits)
+{
+	BitsetInit(outCareMask);
+	BitsetInit(outValueBits);
+	for (const auto& kvp : goal.satisfactions)
+	{
+		BitsetSet(outCareMask, kvp.first);
+		BitsetWrite(outValueBits, kvp.first, kvp.second);
+	}
+}
@@ -0,0 +1,500 @@
+// Michael Adaixo - 2025
+
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+#include "action_table.h"
+#include "binary_heap.h"
+#include "goal.h"
+#include "goal_relevance.h"
+#include "mapped_file.h"
+#include "planner.h"
+
+// GOAL POLICY: Precomputed answer to planning queries for one goal. States are projected onto the
+// goal's relevant facts and packed into a 64-bit key. The build walks forward from the caller's start
+// states to collect every state reachable from them, then runs one backward Dijkstra from the goal
+// states among those; each reachable state stores the cost of an optimal plan and the first action of
+// that plan in an open-addressing table. Planning is then a chain of table reads, and states the table
+// does not hold fall back to A*. The table grows with the reachable set, not with the number of facts.
+constexpr uint32_t kGoalPolicyMaxFacts = 64;
+constexpr uint32_t kGoalPolicyMaxStates = 1u << 20;
+constexpr uint32_t kGoalPolicyNone = UINT32_MAX;      // Slot action when the goal is unreachable
+constexpr uint32_t kGoalPolicyEmpty = UINT32_MAX - 1; // Slot action of an unused slot
+constexpr uint32_t kGoalPolicyVersion = 2;
+constexpr char kGoalPolicyMagic[4] = { 'L', 'G', 'P', 'T' };
+
+// File layout: header, then actionCount GoalPolicyAction, then slotCount GoalPolicySlot.
+// Values are stored in native byte order; a file is only meant to be read on the platform that wrote it.
+struct GoalPolicyHeader
+{
+	char magic[4];
+	uint32_t version;
+	uint32_t stateWords;   // kWorldStateWords of the writer
+	uint32_t factCount;
+	uint32_t actionCount;  // Relevant actions
+	uint32_t tableActions; // Actions in the table the policy was computed with
+	uint32_t entryCount;   // States stored: every reachable state that does not satisfy the goal
+	uint32_t slotCount;    // Hash table capacity, a power of two above entryCount
+	uint64_t actionSignature; // ActionTable signature the policy was computed with
+	bitset_t goalCare;
+	bitset_t goalValue;
+	bitset_t facts; // Bit i of a key is the i-th lowest set bit of facts
+};
+
+// Relevant action with its effects packed into the key space.
+struct GoalPolicyAction
+{
+	uint32_t action; // Index in the full action table
+	uint32_t padding;
+	uint64_t effSet;
+	uint64_t effClear;
+};
+
+struct GoalPolicySlot
+{
+	uint64_t key;    // Packed state
+	float cost;      // Cost of an optimal plan, infinity when the goal is unreachable
+	uint32_t action; // First action of that plan as an index into the policy actions, or kGoalPolicyNone / kGoalPolicyEmpty
+};
+
+static_assert(sizeof(GoalPolicyHeader) % alignof(GoalPolicyAction) == 0, "actions must follow the header aligned");
+static_assert(sizeof(GoalPolicyAction) % alignof(GoalPolicySlot) == 0, "slots must follow the actions aligned");
+
+enum class EGoalPolicyResult
+{
+	Found,       // The plan is optimal
+	Unreachable, // No plan reaches the goal
+	Unknown,     // The state is not in the table
+};
+
+struct GoalPolicy : NoCopy
+{
+	// Views into the file image, which lives in storage after a build or in file after a load
+	const GoalPolicyHeader* header = nullptr;
+	const GoalPolicyAction* actions = nullptr;
+	const GoalPolicySlot* slots = nullptr;
+
+	std::vector<uint8_t> storage;
+	MappedFile file;
+
+	// Derived from the header
+	uint32_t factBits[kGoalPolicyMaxFacts] = {};
+	uint64_t goalCare = 0;
+	uint64_t goalValue = 0;
+	uint32_t slotMask = 0;
+};
+
+inline size_t GoalPolicyImageSize(uint32_t actionCount, uint32_t slotCount)
+{
+	return sizeof(GoalPolicyHeader) + actionCount * sizeof(GoalPolicyAction) + slotCount * sizeof(GoalPolicySlot);
+}
+
+// Packs the bits of mask at factBits into a key.
+inline uint64_t GoalPolicyPack(const uint32_t* factBits, uint32_t factCount, const bitset_t& mask)
+{
+	uint64_t key = 0;
+	for (uint32_t i = 0; i < factCount; ++i)
+	{
+		if (BitsetTest(mask, factBits[i]))
+		{
+			key |= 1ull << i;
+		}
+	}
+	return key;
+}
+
+inline uint64_t GoalPolicyProject(const GoalPolicy& policy, const bitset_t& mask)
+{
+	return GoalPolicyPack(policy.factBits, policy.header->factCount, mask);
+}
+
+inline uint32_t GoalPolicyHome(uint64_t key, uint32_t slotMask)
+{
+	return static_cast<uint32_t>(StateHashMix(key)) & slotMask;
+}
+
+// Returns the slot holding key, or null when the table does not hold it.
+inline const GoalPolicySlot* GoalPolicyFind(const GoalPolicy& policy, uint64_t key)
+{
+	for (uint32_t slot = GoalPolicyHome(key, policy.slotMask); ; slot = (slot + 1) & policy.slotMask)
+	{
+		const GoalPolicySlot& entry = policy.slots[slot];
+		if (entry.action == kGoalPolicyEmpty)
+		{
+			return nullptr;
+		}
+		if (entry.key == key)
+		{
+			return &entry;
+		}
+	}
+}
+
+// Points the views at image and fills in the derived fields. image must hold a validated file image.
+inline void GoalPolicyAttach(GoalPolicy& policy, const uint8_t* image)
+{
+	policy.header = reinterpret_cast<const GoalPolicyHeader*>(image);
+	policy.actions = reinterpret_cast<const GoalPolicyAction*>(image + sizeof(GoalPolicyHeader));
+	policy.slots = reinterpret_cast<const GoalPolicySlot*>(image + sizeof(GoalPolicyHeader) + policy.header->actionCount * sizeof(GoalPolicyAction));
+
+	uint32_t fact = 0;
+	BitsetForEach(policy.header->facts, [&](uint32_t bit)
+	{
+		policy.factBits[fact++] = bit;
+	});
+
+	policy.goalCare = GoalPolicyProject(policy, policy.header->goalCare);
+	policy.goalValue = GoalPolicyProject(policy, policy.header->goalValue);
+	policy.slotMask = policy.header->slotCount - 1;
+}
+
+inline bool GoalPolicyValid(const GoalPolicy& policy)
+{
+	return policy.header != nullptr;
+}
+
+// Computes the policy of goal over table for every state reachable from starts, with one backward
+// Dijkstra from the reachable goal states. Plans never leave the reachable set, so every stored entry
+// is optimal. Returns false, leaving policy empty, when the goal has more than kGoalPolicyMaxFacts
+// relevant facts or more than maxStates states are reachable.
+inline bool GoalPolicyBuild(GoalPolicy& policy, const Goal& goal, const ActionTable& table, const std::vector<WorldState>& starts,
+	uint32_t maxStates = kGoalPolicyMaxStates)
+{
+	policy.file.close();
+	policy.storage.clear();
+	policy.header = nullptr;
+
+	bitset_t goalCare;
+	bitset_t goalValue;
+	GoalGetMasks(goal, goalCare, goalValue);
+
+	GoalRelevance relevance;
+	GoalRelevanceCompute(relevance, table, goalCare, goalValue);
+
+	const uint32_t factCount = BitsetCount(relevance.facts);
+	if (factCount > kGoalPolicyMaxFacts)
+	{
+		return false;
+	}
+
+	uint32_t factBits[kGoalPolicyMaxFacts] = {};
+	uint32_t fact = 0;
+	BitsetForEach(relevance.facts, [&](uint32_t bit)
+	{
+		factBits[fact++] = bit;
+	});
+	const uint64_t care = GoalPolicyPack(factBits, factCount, goalCare);
+	const uint64_t value = GoalPolicyPack(factBits, factCount, goalValue);
+
+	// Relevant preconditions only read relevant facts, so the packed masks describe the actions exactly.
+	const uint32_t actionCount = static_cast<uint32_t>(relevance.actions.size());
+	std::vector<GoalPolicyAction> actions(actionCount);
+	std::vector<uint64_t> preMask(actionCount);
+	std::vector<uint64_t> preValue(actionCount);
+	for (uint32_t a = 0; a < actionCount; ++a)
+	{
+		const uint32_t i = relevance.actions[a];
+		actions[a] = { i, 0, GoalPolicyPack(factBits, factCount, table.effSet[i]), GoalPolicyPack(factBits, factCount, table.effClear[i]) };
+		preMask[a] = GoalPolicyPack(factBits, factCount, table.preMask[i]);
+		preValue[a] = GoalPolicyPack(factBits, factCount, table.preValue[i]);
+	}
+
+	// Forward pass: number the reachable states and record every transition. Goal states end plans,
+	// so their successors are not needed.
+	struct Edge
+	{
+		uint32_t source;
+		uint32_t target;
+		uint32_t action;
+	};
+	std::unordered_map<uint64_t, uint32_t> ids;
+	std::vector<uint64_t> states;
+	std::vector<Edge> edges;
+	auto reach = [&](uint64_t key)
+	{
+		const auto inserted = ids.insert({ key, static_cast<uint32_t>(states.size()) });
+		if (inserted.second)
+		{
+			states.push_back(key);
+		}
+		return inserted.first->second;
+	};
+
+	for (const WorldState& start : starts)
+	{
+		reach(GoalPolicyPack(factBits, factCount, start.stateBits));
+	}
+	for (uint32_t s = 0; s < states.size(); ++s)
+	{
+		if (states.size() > maxStates)
+		{
+			return false;
+		}
+
+		const uint64_t key = states[s];
+		if ((key & care) == value)
+		{
+			continue;
+		}
+		for (uint32_t a = 0; a < actionCount; ++a)
+		{
+			if ((key & preMask[a]) == preValue[a])
+			{
+				const uint32_t target = reach((key & ~actions[a].effClear) | actions[a].effSet);
+				edges.push_back({ s, target, a });
+			}
+		}
+	}
+	const uint32_t stateCount = static_cast<uint32_t>(states.size());
+
+	// Group the transitions by target so the backward pass can walk them.
+	std::vector<uint32_t> firstEdge(stateCount + 1, 0);
+	for (const Edge& edge : edges)
+	{
+		firstEdge[edge.target + 1]++;
+	}
+	for (uint32_t s = 0; s < stateCount; ++s)
+	{
+		firstEdge[s + 1] += firstEdge[s];
+	}
+	std::vector<Edge> incoming(edges.size());
+	std::vector<uint32_t> fill(firstEdge.begin(), firstEdge.end() - 1);
+	for (const Edge& edge : edges)
+	{
+		incoming[fill[edge.target]++] = edge;
+	}
+
+	std::vector<float> cost(stateCount, INFINITY);
+	std::vector<uint32_t> next(stateCount, kGoalPolicyNone);
+	BinaryHeap<PlanOpenEntry> open(static_cast<int>(stateCount));
+	uint32_t entryCount = 0;
+	for (uint32_t s = 0; s < stateCount; ++s)
+	{
+		if ((states[s] & care) == value)
+		{
+			cost[s] = 0.0f;
+			open.insert({ 0.0f, 0.0f, s });
+		}
+		else
+		{
+			entryCount++;
+		}
+	}
+
+	while (!open.empty())
+	{
+		const PlanOpenEntry top = open.extractMin();
+		if (top.f > cost[top.node])
+		{
+			continue; // Stale
+		}
+
+		for (uint32_t e = firstEdge[top.node]; e < firstEdge[top.node + 1]; ++e)
+		{
+			const Edge& edge = incoming[e];
+			const float sourceCost = top.f + table.cost[actions[edge.action].action];
+			if (sourceCost < cost[edge.source])
+			{
+				cost[edge.source] = sourceCost;
+				next[edge.source] = edge.action;
+				open.insert({ sourceCost, 0.0f, edge.source });
+			}
+		}
+	}
+
+	// At most half full, so probes stay short and an empty slot always ends a miss.
+	uint32_t slotCount = 1;
+	while (slotCount < 2 * entryCount)
+	{
+		slotCount *= 2;
+	}
+	policy.storage.assign(GoalPolicyImageSize(actionCount, slotCount), 0);
+
+	GoalPolicyHeader header = {};
+	std::memcpy(header.magic, kGoalPolicyMagic, sizeof(header.magic));
+	header.version = kGoalPolicyVersion;
+	header.stateWords = static_cast<uint32_t>(kWorldStateWords);
+	header.factCount = factCount;
+	header.actionCount = actionCount;
+	header.tableActions = static_cast<uint32_t>(ActionTableSize(table));
+	header.entryCount = entryCount;
+	header.slotCount = slotCount;
+	header.actionSignature = table.signature;
+	header.goalCare = goalCare;
+	header.goalValue = goalValue;
+	header.facts = relevance.facts;
+	std::memcpy(policy.storage.data(), &header, sizeof(header));
+	if (actionCount > 0)
+	{
+		std::memcpy(policy.storage.data() + sizeof(GoalPolicyHeader), actions.data(), actionCount * sizeof(GoalPolicyAction));
+	}
+	GoalPolicyAttach(policy, policy.storage.data());
+
+	GoalPolicySlot* slots = reinterpret_cast<GoalPolicySlot*>(policy.storage.data() + sizeof(GoalPolicyHeader) + actionCount * sizeof(GoalPolicyAction));
+	for (uint32_t slot = 0; slot < slotCount; ++slot)
+	{
+		slots[slot] = { 0, 0.0f, kGoalPolicyEmpty };
+	}
+	for (uint32_t s = 0; s < stateCount; ++s)
+	{
+		if ((states[s] & care) == value)
+		{
+			continue;
+		}
+
+		uint32_t slot = GoalPolicyHome(states[s], policy.slotMask);
+		while (slots[slot].action != kGoalPolicyEmpty)
+		{
+			slot = (slot + 1) & policy.slotMask;
+		}
+		slots[slot] = { states[s], cost[s], next[s] };
+	}
+
+	return true;
+}
+
+// Writes the policy to path so it can be mapped with GoalPolicyLoad().
+inline bool GoalPolicySave(const GoalPolicy& policy, const char* path)
+{
+	if (!GoalPolicyValid(policy))
+	{
+		return false;
+	}
+
+	FILE* out = std::fopen(path, "wb");
+	if (out == nullptr)
+	{
+		return false;
+	}
+
+	const size_t size = GoalPolicyImageSize(policy.header->actionCount, policy.header->slotCount);
+	const bool written = std::fwrite(policy.header, 1, size, out) == size;
+	return std::fclose(out) == 0 && written;
+}
+
+// Checks that image of size bytes is a policy this build can answer from: the format and sizes
+// match, every action index is in range, and the table holds entryCount states with room to spare.
+inline bool GoalPolicyValidate(const uint8_t* image, size_t size)
+{
+	if (size < sizeof(GoalPolicyHeader))
+	{
+		return false;
+	}
+
+	GoalPolicyHeader header;
+	std::memcpy(&header, image, sizeof(header));
+	if (std::memcmp(header.magic, kGoalPolicyMagic, sizeof(header.magic)) != 0 || header.version != kGoalPolicyVersion
+		|| header.stateWords != kWorldStateWords || header.factCount > kGoalPolicyMaxFacts || BitsetCount(header.facts) != header.factCount
+		|| header.slotCount == 0 || (header.slotCount & (header.slotCount - 1)) != 0 || header.entryCount >= header.slotCount
+		|| size != GoalPolicyImageSize(header.actionCount, header.slotCount))
+	{
+		return false;
+	}
+
+	const GoalPolicyAction* actions = reinterpret_cast<const GoalPolicyAction*>(image + sizeof(GoalPolicyHeader));
+	for (uint32_t a = 0; a < header.actionCount; ++a)
+	{
+		if (actions[a].action >= header.tableActions)
+		{
+			return false;
+		}
+	}
+
+	const GoalPolicySlot* slots = reinterpret_cast<const GoalPolicySlot*>(image + sizeof(GoalPolicyHeader) + header.actionCount * sizeof(GoalPolicyAction));
+	uint32_t used = 0;
+	for (uint32_t slot = 0; slot < header.slotCount; ++slot)
+	{
+		const uint32_t action = slots[slot].action;
+		if (action == kGoalPolicyEmpty)
+		{
+			continue;
+		}
+		if (action != kGoalPolicyNone && action >= header.actionCount)
+		{
+			return false;
+		}
+		used++;
+	}
+	return used == header.entryCount;
+}
+
+// Maps a policy written by GoalPolicySave(). Returns false, leaving policy empty, when the file is
+// missing or fails GoalPolicyValidate().
+inline bool GoalPolicyLoad(GoalPolicy& policy, const char* path)
+{
+	policy.storage.clear();
+	policy.header = nullptr;
+
+	if (!policy.file.open(path) || !GoalPolicyValidate(policy.file.data(), policy.file.size()))
+	{
+		policy.file.close();
+		return false;
+	}
+
+	GoalPolicyAttach(policy, policy.file.data());
+	return true;
+}
+
+// True when policy answers queries for the goal masks over table.
+inline bool GoalPolicyMatches(const GoalPolicy& policy, const bitset_t& goalCare, const bitset_t& goalValue, const ActionTable& table)
+{
+	return GoalPolicyValid(policy) && policy.header->actionSignature == table.signature && policy.header->tableActions == ActionTableSize(table)
+		&& policy.header->goalCare == goalCare && policy.header->goalValue == goalValue;
+}
+
+// Follows the policy from state, writing the plan to outPlan. Returns Unknown, with outPlan empty,
+// when state was not reachable from the starts the policy was built for. table must match the policy.
+inline EGoalPolicyResult GoalPolicyLookup(const GoalPolicy& policy, const WorldState& state, const ActionTable& table, std::vector<Action*>& outPlan)
+{
+	outPlan.clear();
+
+	uint64_t key = GoalPolicyProject(policy, state.stateBits);
+	for (uint32_t steps = 0; (key & policy.goalCare) != policy.goalValue; ++steps)
+	{
+		const GoalPolicySlot* entry = GoalPolicyFind(policy, key);
+		if (entry == nullptr || steps == policy.header->entryCount)
+		{
+			outPlan.clear();
+			return EGoalPolicyResult::Unknown;
+		}
+		if (entry->action == kGoalPolicyNone)
+		{
+			outPlan.clear();
+			return EGoalPolicyResult::Unreachable;
+		}
+
+		const GoalPolicyAction& action = policy.actions[entry->action];
+		outPlan.push_back(table.actions[action.action]);
+		key = (key & ~action.effClear) | action.effSet;
+	}
+	return EGoalPolicyResult::Found;
+}
+
+// Plan() that answers from policy when it was built for this goal and action set and holds the state,
+// and searches otherwise. When the policy answers, context.plan receives the plan and context.stats
+// are zeroed, since no search ran.
+template<typename TOpenList>
+inline bool PlanWithPolicy(BasicPlannerContext<TOpenList>& context, const GoalPolicy& policy, const Goal& goal, const WorldState& state,
+	const ActionTable& actions, const PlanOptions& options = {})
+{
+	bitset_t goalCare;
+	bitset_t goalValue;
+	GoalGetMasks(goal, goalCare, goalValue);
+
+	if (GoalPolicyMatches(policy, goalCare, goalValue, actions))
+	{
+		const EGoalPolicyResult result = GoalPolicyLookup(policy, state, actions, context.plan);
+		if (result != EGoalPolicyResult::Unknown)
+		{
+			context.stats = {};
+			return result == EGoalPolicyResult::Found;
+		}
+	}
+	return Plan(context, goal, state, actions, options);
+}
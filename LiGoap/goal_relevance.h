@@ -0,0 +1,134 @@
+// Michael Adaixo - 2025
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "action_table.h"
+
+// GOAL RELEVANCE: Actions and facts that can matter for one goal, found by walking backward
+// from the goal literals. An action is relevant when it makes a relevant literal true; its
+// precondition literals then become relevant too. Every other action only writes values no
+// relevant action or the goal ever asks for, so dropping them keeps every plan valid and
+// never makes one more expensive.
+struct GoalRelevance
+{
+	// Cache key
+	bitset_t goalCare = {};
+	bitset_t goalValue = {};
+	uint64_t actionSignature = 0;
+	uint64_t lastUse = 0;
+	bool valid = false;
+
+	bitset_t needTrue = {};  // Facts some relevant action or the goal requires to be true
+	bitset_t needFalse = {}; // Facts some relevant action or the goal requires to be false
+	bitset_t facts = {};     // needTrue | needFalse: the only facts the search has to track
+
+	std::vector<uint32_t> actions;    // Indices of the relevant actions in the full table
+	std::vector<Action*> actionList;  // The same actions, used to build table
+	ActionTable table;                // Relevant actions only, with effects masked to facts
+};
+
+// True when the action at index i of table makes a literal in (needTrue, needFalse) true.
+inline bool GoalRelevanceAchieves(const ActionTable& table, size_t i, const bitset_t& needTrue, const bitset_t& needFalse)
+{
+	return BitsetAny((table.effSet[i] & needTrue) | (table.effClear[i] & needFalse));
+}
+
+inline void GoalRelevanceCompute(GoalRelevance& relevance, const ActionTable& table, const bitset_t& goalCare, const bitset_t& goalValue)
+{
+	bitset_t needTrue = goalCare & goalValue;
+	bitset_t needFalse = goalCare & ~goalValue;
+
+	const size_t count = ActionTableSize(table);
+	bool changed = true;
+	while (changed)
+	{
+		changed = false;
+		for (size_t i = 0; i < count; ++i)
+		{
+			if (!GoalRelevanceAchieves(table, i, needTrue, needFalse))
+			{
+				continue;
+			}
+
+			const bitset_t preTrue = table.preMask[i] & table.preValue[i];
+			const bitset_t preFalse = table.preMask[i] & ~table.preValue[i];
+			if (BitsetAny(preTrue & ~needTrue) || BitsetAny(preFalse & ~needFalse))
+			{
+				needTrue |= preTrue;
+				needFalse |= preFalse;
+				changed = true;
+			}
+		}
+	}
+
+	relevance.needTrue = needTrue;
+	relevance.needFalse = needFalse;
+	relevance.facts = needTrue | needFalse;
+
+	relevance.actions.clear();
+	relevance.actionList.clear();
+	for (size_t i = 0; i < count; ++i)
+	{
+		if (GoalRelevanceAchieves(table, i, needTrue, needFalse))
+		{
+			relevance.actions.push_back(static_cast<uint32_t>(i));
+			relevance.actionList.push_back(table.actions[i]);
+		}
+	}
+
+	// Writes to untracked facts are dropped, so search states never leave the projection.
+	ActionTableBuild(relevance.table, relevance.actionList);
+	for (size_t i = 0; i < relevance.actionList.size(); ++i)
+	{
+		relevance.table.effSet[i] &= relevance.facts;
+		relevance.table.effClear[i] &= relevance.facts;
+	}
+	ActionTableUpdateSignature(relevance.table);
+
+	relevance.goalCare = goalCare;
+	relevance.goalValue = goalValue;
+	relevance.actionSignature = table.signature;
+	relevance.valid = true;
+}
+
+constexpr size_t kGoalRelevanceSlots = 8;
+
+// Recently used analyses, keyed by (goal, action table signature). Not thread-safe.
+struct GoalRelevanceCache
+{
+	GoalRelevance entries[kGoalRelevanceSlots];
+	uint64_t useClock = 0;
+};
+
+// Returns the analysis for the goal masks and table, computing it into the least recently used
+// slot on a miss. The reference stays valid until the next call that misses.
+inline const GoalRelevance& GoalRelevanceGet(GoalRelevanceCache& cache, const ActionTable& table, const bitset_t& goalCare, const bitset_t& goalValue)
+{
+	GoalRelevance* oldest = &cache.entries[0];
+	for (GoalRelevance& entry : cache.entries)
+	{
+		if (entry.valid && entry.actionSignature == table.signature && entry.goalCare == goalCare && entry.goalValue == goalValue)
+		{
+			// Equal signatures only guarantee equal masks; the Action objects may be new copies.
+			for (size_t i = 0; i < entry.actions.size(); ++i)
+			{
+				entry.table.actions[i] = table.actions[entry.actions[i]];
+			}
+			entry.lastUse = ++cache.useClock;
+			return entry;
+		}
+
+		// Unused slots have lastUse 0, so they are taken first.
+		if (entry.lastUse < oldest->lastUse)
+		{
+			oldest = &entry;
+		}
+	}
+
+	GoalRelevanceCompute(*oldest, table, goalCare, goalValue);
+	oldest->lastUse = ++cache.useClock;
+	return *oldest;
+}
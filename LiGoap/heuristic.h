@@ -0,0 +1,350 @@
+// Michael Adaixo - 2025
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <vector>
+
+#include "action_table.h"
+#include "binary_heap.h"
+#include "bitset.h"
+
+enum class EPlanHeuristic
+{
+	GoalCount, // Unsatisfied goal facts; cheap but blind to action costs
+	HMax,      // Relaxed plan cost, max over subgoals; admissible
+	HAdd,      // Relaxed plan cost, sum over subgoals; stronger but not admissible
+};
+
+constexpr float kHeuristicDeadEnd = std::numeric_limits<float>::infinity();
+
+// A literal is one fact with one value: index 2 * key for true, 2 * key + 1 for false.
+constexpr size_t kRelaxedLiteralCount = 2 * kBitsetBits;
+
+using relaxed_literal_t = uint16_t;
+
+constexpr relaxed_literal_t RelaxedLiteral(uint32_t bit, bool value)
+{
+	return static_cast<relaxed_literal_t>(bit * 2 + (value ? 0 : 1));
+}
+
+// Action reduced to literal lists for the relaxed planning graph, which ignores delete effects.
+struct RelaxedAction
+{
+	uint32_t firstPre;
+	uint32_t preCount;
+	uint32_t firstEff;
+	uint32_t effCount;
+	float cost;
+};
+
+struct RelaxedQueueEntry
+{
+	float cost;
+	relaxed_literal_t literal;
+
+	bool operator<(const RelaxedQueueEntry& Other) const { return cost < Other.cost; }
+	bool operator>(const RelaxedQueueEntry& Other) const { return cost > Other.cost; }
+};
+
+// Per-solve state of RelaxedSolve(), shared by every table type.
+struct RelaxedScratch
+{
+	std::vector<uint32_t> unmet;   // Preconditions of each action not settled yet
+	std::vector<float> preCost;    // Max or sum over the settled preconditions of each action
+	BinaryHeap<RelaxedQueueEntry> queue{ static_cast<int>(kRelaxedLiteralCount) };
+	bool settled[kRelaxedLiteralCount];
+
+	float cost[kRelaxedLiteralCount]; // Cost of each literal after the last RelaxedSolve
+};
+
+inline void RelaxedScratchResize(RelaxedScratch& scratch, size_t actionCount)
+{
+	scratch.unmet.resize(actionCount);
+	scratch.preCost.resize(actionCount);
+}
+
+// RELAXED HEURISTIC: h_max / h_add over the compiled action masks.
+// The literal lists are derived once per (goal, action set) and reused by every
+// evaluation until either changes; evaluation is one generalized Dijkstra over those lists.
+// Static domains build the same tables at compile time, see StaticRelaxedTables.
+struct RelaxedHeuristic
+{
+	// Cache key of the prepared tables
+	bitset_t goalCare = {};
+	bitset_t goalValue = {};
+	uint64_t actionSignature = 0;
+	bool prepared = false;
+
+	std::vector<RelaxedAction> actions;
+	std::vector<relaxed_literal_t> literals;     // Pre and effect literals, sliced by RelaxedAction
+	std::vector<relaxed_literal_t> usedLiterals; // Every literal a precondition or the goal reads
+	std::vector<uint32_t> preActions;            // Actions reading each literal, sliced by preFirst
+	uint32_t preFirst[kRelaxedLiteralCount + 1];
+	bool goalLiteral[kRelaxedLiteralCount];
+	uint32_t goalLiteralCount = 0;
+
+	RelaxedScratch scratch; // Sized once per prepare
+};
+
+// Appends the literals of careMask to the literal list, keeping only those marked in keep when given.
+inline void RelaxedHeuristicAddLiterals(RelaxedHeuristic& heuristic, const bitset_t& careMask, const bitset_t& valueBits, const bool* keep = nullptr)
+{
+	BitsetForEach(careMask, [&](uint32_t bit)
+	{
+		const relaxed_literal_t literal = RelaxedLiteral(bit, BitsetTest(valueBits, bit));
+		if (keep == nullptr || keep[literal])
+		{
+			heuristic.literals.push_back(literal);
+		}
+	});
+}
+
+inline void RelaxedHeuristicMarkLiterals(const bitset_t& careMask, const bitset_t& valueBits, bool marks[kRelaxedLiteralCount])
+{
+	BitsetForEach(careMask, [&](uint32_t bit)
+	{
+		marks[RelaxedLiteral(bit, BitsetTest(valueBits, bit))] = true;
+	});
+}
+
+// Rebuilds the literal lists unless they were already built for this goal and action set.
+inline void RelaxedHeuristicPrepare(RelaxedHeuristic& heuristic, const bitset_t& goalCare, const bitset_t& goalValue, const ActionTable& table)
+{
+	if (heuristic.prepared && heuristic.goalCare == goalCare && heuristic.goalValue == goalValue
+		&& heuristic.actionSignature == table.signature)
+	{
+		return;
+	}
+
+	heuristic.actions.clear();
+	heuristic.literals.clear();
+	heuristic.usedLiterals.clear();
+
+	// Only literals some precondition or the goal reads have a cost worth computing; effects on
+	// any other literal are left out of the lists.
+	bool used[kRelaxedLiteralCount] = {};
+	const size_t count = ActionTableSize(table);
+	for (size_t i = 0; i < count; ++i)
+	{
+		RelaxedHeuristicMarkLiterals(table.preMask[i], table.preValue[i], used);
+	}
+	RelaxedHeuristicMarkLiterals(goalCare, goalValue, used);
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		RelaxedAction action;
+		action.cost = table.cost[i];
+
+		action.firstPre = static_cast<uint32_t>(heuristic.literals.size());
+		RelaxedHeuristicAddLiterals(heuristic, table.preMask[i], table.preValue[i]);
+		action.preCount = static_cast<uint32_t>(heuristic.literals.size()) - action.firstPre;
+
+		action.firstEff = static_cast<uint32_t>(heuristic.literals.size());
+		RelaxedHeuristicAddLiterals(heuristic, table.effSet[i] | table.effClear[i], table.effSet[i], used);
+		action.effCount = static_cast<uint32_t>(heuristic.literals.size()) - action.firstEff;
+
+		heuristic.actions.push_back(action);
+	}
+
+	for (size_t literal = 0; literal < kRelaxedLiteralCount; ++literal)
+	{
+		if (used[literal])
+		{
+			heuristic.usedLiterals.push_back(static_cast<relaxed_literal_t>(literal));
+		}
+	}
+
+	// Index the actions by precondition literal, so a settled literal only visits its readers.
+	const uint32_t actionCount = static_cast<uint32_t>(heuristic.actions.size());
+	std::fill(std::begin(heuristic.preFirst), std::end(heuristic.preFirst), 0);
+	for (uint32_t a = 0; a < actionCount; ++a)
+	{
+		const RelaxedAction& action = heuristic.actions[a];
+		for (uint32_t i = 0; i < action.preCount; ++i)
+		{
+			heuristic.preFirst[heuristic.literals[action.firstPre + i] + 1]++;
+		}
+	}
+	for (size_t literal = 0; literal < kRelaxedLiteralCount; ++literal)
+	{
+		heuristic.preFirst[literal + 1] += heuristic.preFirst[literal];
+	}
+
+	uint32_t fill[kRelaxedLiteralCount];
+	std::copy(std::begin(heuristic.preFirst), std::end(heuristic.preFirst) - 1, fill);
+	heuristic.preActions.resize(heuristic.preFirst[kRelaxedLiteralCount]);
+	for (uint32_t a = 0; a < actionCount; ++a)
+	{
+		const RelaxedAction& action = heuristic.actions[a];
+		for (uint32_t i = 0; i < action.preCount; ++i)
+		{
+			heuristic.preActions[fill[heuristic.literals[action.firstPre + i]]++] = a;
+		}
+	}
+
+	std::fill(std::begin(heuristic.goalLiteral), std::end(heuristic.goalLiteral), false);
+	heuristic.goalLiteralCount = 0;
+	BitsetForEach(goalCare, [&](uint32_t bit)
+	{
+		heuristic.goalLiteral[RelaxedLiteral(bit, BitsetTest(goalValue, bit))] = true;
+		heuristic.goalLiteralCount++;
+	});
+
+	RelaxedScratchResize(heuristic.scratch, actionCount);
+
+	heuristic.goalCare = goalCare;
+	heuristic.goalValue = goalValue;
+	heuristic.actionSignature = table.signature;
+	heuristic.prepared = true;
+}
+
+// Computes the relaxed cost of every used literal when starting from stateBits. Literals settle in
+// cost order and an action fires once its last precondition settles, so each literal and action is
+// processed once. With stopAtGoal the pass ends once every goal literal has settled; the costs of
+// literals still queued are then upper bounds only.
+// Table is RelaxedHeuristic or any type with the same members (actions, literals, usedLiterals,
+// preFirst, preActions, goalLiteral, goalLiteralCount); scratch must be sized for its actions.
+template<typename Table, typename StateBits>
+inline void RelaxedSolve(const Table& table, RelaxedScratch& scratch, EPlanHeuristic kind, const StateBits& stateBits, bool stopAtGoal = false)
+{
+	float* cost = scratch.cost;
+	bool* settled = scratch.settled;
+	uint32_t* unmet = scratch.unmet.data();
+	float* preCosts = scratch.preCost.data();
+	const RelaxedAction* actions = table.actions.data();
+	const relaxed_literal_t* literals = table.literals.data();
+	BinaryHeap<RelaxedQueueEntry>& queue = scratch.queue;
+	queue.clear();
+
+	const uint32_t actionCount = static_cast<uint32_t>(table.actions.size());
+	for (uint32_t a = 0; a < actionCount; ++a)
+	{
+		unmet[a] = actions[a].preCount;
+		preCosts[a] = 0.0f;
+	}
+
+	auto fire = [&](uint32_t a)
+	{
+		const RelaxedAction& action = actions[a];
+		const float reached = preCosts[a] + action.cost;
+		for (uint32_t i = 0; i < action.effCount; ++i)
+		{
+			const relaxed_literal_t effect = literals[action.firstEff + i];
+			if (reached < cost[effect])
+			{
+				cost[effect] = reached;
+				queue.insert({ reached, effect });
+			}
+		}
+	};
+
+	// Literals that hold cost nothing and settle first, in any order, so they skip the queue:
+	// they only count down the preconditions of their readers.
+	uint32_t goalsLeft = table.goalLiteralCount;
+	for (const relaxed_literal_t literal : table.usedLiterals)
+	{
+		const bool value = (literal & 1) == 0;
+		const bool holds = BitsetTest(stateBits, literal >> 1) == value;
+		cost[literal] = holds ? 0.0f : kHeuristicDeadEnd;
+		settled[literal] = holds;
+		goalsLeft -= holds && table.goalLiteral[literal] ? 1 : 0;
+	}
+	if (stopAtGoal && goalsLeft == 0)
+	{
+		return;
+	}
+	for (const relaxed_literal_t literal : table.usedLiterals)
+	{
+		if (settled[literal])
+		{
+			for (uint32_t i = table.preFirst[literal]; i < table.preFirst[literal + 1]; ++i)
+			{
+				unmet[table.preActions[i]]--;
+			}
+		}
+	}
+	for (uint32_t a = 0; a < actionCount; ++a)
+	{
+		if (unmet[a] == 0)
+		{
+			fire(a);
+		}
+	}
+
+	while (!queue.empty())
+	{
+		// The first entry of a literal to come out carries its final cost; later ones are stale.
+		const RelaxedQueueEntry top = queue.extractMin();
+		if (settled[top.literal])
+		{
+			continue;
+		}
+		settled[top.literal] = true;
+
+		if (stopAtGoal && table.goalLiteral[top.literal] && --goalsLeft == 0)
+		{
+			return;
+		}
+
+		for (uint32_t i = table.preFirst[top.literal]; i < table.preFirst[top.literal + 1]; ++i)
+		{
+			const uint32_t a = table.preActions[i];
+			preCosts[a] = kind == EPlanHeuristic::HMax
+				? (top.cost > preCosts[a] ? top.cost : preCosts[a])
+				: preCosts[a] + top.cost;
+			if (--unmet[a] == 0)
+			{
+				fire(a);
+			}
+		}
+	}
+}
+
+// Combines the literal costs of the last solve over a set of required facts.
+// Returns kHeuristicDeadEnd when one of them cannot be reached even in the relaxation.
+template<typename Bits>
+inline float RelaxedCombine(const RelaxedScratch& scratch, EPlanHeuristic kind, const Bits& careMask, const Bits& valueBits)
+{
+	float total = 0.0f;
+	BitsetForEach(careMask, [&](uint32_t bit)
+	{
+		const float literalCost = scratch.cost[RelaxedLiteral(bit, BitsetTest(valueBits, bit))];
+		total = kind == EPlanHeuristic::HMax
+			? (literalCost > total ? literalCost : total)
+			: total + literalCost;
+	});
+	return total;
+}
+
+// Forward search estimate from stateBits to the goal of table, which also needs goalCare and goalValue.
+template<typename Table, typename StateBits>
+inline float RelaxedEvaluate(const Table& table, RelaxedScratch& scratch, EPlanHeuristic kind, const StateBits& stateBits)
+{
+	if (kind == EPlanHeuristic::GoalCount)
+	{
+		return static_cast<float>(BitsetCount((stateBits ^ table.goalValue) & table.goalCare));
+	}
+
+	RelaxedSolve(table, scratch, kind, stateBits, true);
+	return RelaxedCombine(scratch, kind, table.goalCare, table.goalValue);
+}
+
+inline void RelaxedHeuristicSolve(RelaxedHeuristic& heuristic, EPlanHeuristic kind, const bitset_t& stateBits)
+{
+	RelaxedSolve(heuristic, heuristic.scratch, kind, stateBits);
+}
+
+inline float RelaxedHeuristicCombine(const RelaxedHeuristic& heuristic, EPlanHeuristic kind, const bitset_t& careMask, const bitset_t& valueBits)
+{
+	return RelaxedCombine(heuristic.scratch, kind, careMask, valueBits);
+}
+
+// Forward search estimate from stateBits to the prepared goal.
+inline float RelaxedHeuristicEvaluate(RelaxedHeuristic& heuristic, EPlanHeuristic kind, const bitset_t& stateBits)
+{
+	return RelaxedEvaluate(heuristic, heuristic.scratch, kind, stateBits);
+}
@@ -0,0 +1,392 @@
+// Michael Adaixo - 2025
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "action.h"
+#include "action_table.h"
+#include "goal.h"
+#include "planner.h"
+
+// MACRO ACTIONS: Action sequences that keep showing up in plans, composed into one synthetic
+// Action with the merged masks and summed cost of its steps. The search takes a macro in one
+// expansion instead of rediscovering the sequence a step at a time, and the returned plan is
+// expanded back into the primitive steps. A macro is exactly as expensive as its steps, so an
+// optimal search finds plans of the same cost with or without macros; MacroLibraryVerify checks
+// this against recorded queries and drops the macros that made any plan more expensive, which can
+// happen with an inadmissible heuristic or a weight above 1.
+struct MacroMiningOptions
+{
+	uint32_t minSupport = 3; // Occurrences a fragment needs before it becomes a macro
+	uint32_t maxLength = 3;  // Longest fragment, in primitive steps
+	uint32_t maxMacros = 16; // Fragments kept, by expansions saved
+};
+
+// Recorded planning query, replanned by MacroLibraryVerify.
+struct MacroQuery
+{
+	Goal goal;
+	WorldState state;
+};
+
+// Counts every fragment of 2 to maxLength consecutive steps in the recorded plans.
+struct MacroMiner : NoCopy
+{
+	const std::vector<Action*>* primitives = nullptr;
+	std::unordered_map<const Action*, uint32_t> primitiveIndex;
+	std::map<std::vector<uint32_t>, uint32_t> fragments; // Primitive indices -> occurrences
+	std::vector<MacroQuery> queries;
+	uint32_t maxLength = 3;
+	uint32_t plans = 0;
+};
+
+struct MacroAction
+{
+	Action action;              // Composed masks and summed cost, named after its steps joined with '+'
+	std::vector<Action*> steps; // Primitive actions, in execution order
+	uint32_t support = 0;       // Occurrences in the mined plans
+	bool enabled = true;        // Cleared by MacroLibraryVerify
+};
+
+// Primitives plus the enabled macros, as one action list and table to plan with.
+struct MacroLibrary : NoCopy
+{
+	std::deque<MacroAction> macros; // Deque keeps the Action addresses stable
+	std::vector<Action*> actions;   // Primitives first, then the enabled macros
+	size_t primitiveCount = 0;
+	ActionTable table;              // Built from actions
+	ActionTable primitiveTable;     // Primitives only, for verification
+};
+
+// Composes first followed by second into out. Returns false when second can never run right
+// after first, because first leaves or requires a fact the other way round.
+inline bool MacroCompose(Action& out, const Action& first, const Action& second)
+{
+	const bitset_t written = first.effSet | first.effClear;
+	const bitset_t secondTrue = second.preMask & second.preValue;
+	const bitset_t secondFalse = second.preMask & ~second.preValue;
+	if (BitsetAny(secondTrue & first.effClear) || BitsetAny(secondFalse & first.effSet))
+	{
+		return false;
+	}
+
+	// Preconditions on facts first leaves alone must already hold before first.
+	const bitset_t passThrough = second.preMask & ~written;
+	if (BitsetAny(passThrough & first.preMask & (first.preValue ^ second.preValue)))
+	{
+		return false;
+	}
+
+	out.preMask = first.preMask | passThrough;
+	out.preValue = first.preValue | (second.preValue & passThrough);
+	out.effSet = (first.effSet & ~second.effClear) | second.effSet;
+	out.effClear = (first.effClear & ~second.effSet) | second.effClear;
+	return true;
+}
+
+// Rebuilds pre/eff from the compiled masks so a later ActionFinalize reproduces them.
+inline void MacroSyncMaps(Action& action)
+{
+	action.pre.clear();
+	action.eff.clear();
+	BitsetForEach(action.preMask, [&](uint32_t bit)
+	{
+		action.pre.insert({ static_cast<EKeyAtom>(bit), BitsetTest(action.preValue, bit) });
+	});
+	BitsetForEach(action.effSet | action.effClear, [&](uint32_t bit)
+	{
+		action.eff.insert({ static_cast<EKeyAtom>(bit), BitsetTest(action.effSet, bit) });
+	});
+	action.finalized = true;
+}
+
+// Builds the macro for steps. Returns false when the steps cannot run back to back, the summed
+// cost does not fit Action::cost, or the sequence changes nothing.
+inline bool MacroBuild(MacroAction& macro, const std::vector<Action*>& steps)
+{
+	Action& action = macro.action;
+	action.preMask = steps[0]->preMask;
+	action.preValue = steps[0]->preValue;
+	action.effSet = steps[0]->effSet;
+	action.effClear = steps[0]->effClear;
+
+	int cost = steps[0]->cost;
+	std::string name = steps[0]->name;
+	for (size_t i = 1; i < steps.size(); ++i)
+	{
+		Action composed;
+		if (!MacroCompose(composed, action, *steps[i]))
+		{
+			return false;
+		}
+		action.preMask = composed.preMask;
+		action.preValue = composed.preValue;
+		action.effSet = composed.effSet;
+		action.effClear = composed.effClear;
+
+		cost += steps[i]->cost;
+		name += '+';
+		name += steps[i]->name;
+	}
+
+	if (cost > INT8_MAX || !BitsetAny(action.effSet | action.effClear))
+	{
+		return false;
+	}
+
+	action.name = std::move(name);
+	action.cost = static_cast<int8_t>(cost);
+	MacroSyncMaps(action);
+	macro.steps = steps;
+	return true;
+}
+
+// Starts mining plans made of primitives. primitives must outlive the miner.
+inline void MacroMinerReset(MacroMiner& miner, const std::vector<Action*>& primitives, uint32_t maxLength = 3)
+{
+	miner.primitives = &primitives;
+	miner.primitiveIndex.clear();
+	for (uint32_t i = 0; i < primitives.size(); ++i)
+	{
+		miner.primitiveIndex.insert({ primitives[i], i });
+	}
+	miner.fragments.clear();
+	miner.queries.clear();
+	miner.maxLength = std::max(2u, maxLength);
+	miner.plans = 0;
+}
+
+// Counts the fragments of an executed or benchmarked plan and keeps its query for verification.
+// Fragments containing an action outside the primitives are skipped.
+inline void MacroMinerRecord(MacroMiner& miner, const Goal& goal, const WorldState& state, const std::vector<Action*>& plan)
+{
+	miner.queries.push_back({ goal, state });
+	miner.plans++;
+
+	std::vector<uint32_t> indices;
+	indices.reserve(plan.size());
+	for (const Action* action : plan)
+	{
+		const auto found = miner.primitiveIndex.find(action);
+		indices.push_back(found != miner.primitiveIndex.end() ? found->second : UINT32_MAX);
+	}
+
+	std::vector<uint32_t> fragment;
+	for (size_t first = 0; first < indices.size(); ++first)
+	{
+		fragment.clear();
+		for (size_t i = first; i < indices.size() && fragment.size() < miner.maxLength; ++i)
+		{
+			if (indices[i] == UINT32_MAX)
+			{
+				break;
+			}
+			fragment.push_back(indices[i]);
+			if (fragment.size() >= 2)
+			{
+				miner.fragments[fragment]++;
+			}
+		}
+	}
+}
+
+// True when other has the same masks as macro and costs no more, making macro useless.
+inline bool MacroDominatedBy(const Action& macro, const Action& other)
+{
+	return other.preMask == macro.preMask && other.preValue == macro.preValue &&
+		other.effSet == macro.effSet && other.effClear == macro.effClear && other.cost <= macro.cost;
+}
+
+// Lists the primitives and the enabled macros in library.actions and rebuilds library.table.
+inline void MacroLibraryRebuild(MacroLibrary& library)
+{
+	library.actions.resize(library.primitiveCount);
+	for (MacroAction& macro : library.macros)
+	{
+		if (macro.enabled)
+		{
+			library.actions.push_back(&macro.action);
+		}
+	}
+	ActionTableBuild(library.table, library.actions);
+}
+
+// Turns the most valuable mined fragments into macros. A fragment is worth support * (length - 1)
+// expansions; fragments that cannot be composed, or compose to the masks and cost of a primitive
+// or an earlier macro, are skipped.
+inline void MacroLibraryBuild(MacroLibrary& library, const MacroMiner& miner, const MacroMiningOptions& options = {})
+{
+	const std::vector<Action*>& primitives = *miner.primitives;
+	library.macros.clear();
+	library.primitiveCount = primitives.size();
+	library.actions = primitives;
+	ActionTableBuild(library.primitiveTable, primitives);
+
+	struct Candidate
+	{
+		const std::vector<uint32_t>* fragment;
+		uint32_t support;
+		uint64_t saved;
+	};
+	std::vector<Candidate> candidates;
+	for (const auto& kvp : miner.fragments)
+	{
+		if (kvp.second >= options.minSupport && kvp.first.size() <= options.maxLength)
+		{
+			candidates.push_back({ &kvp.first, kvp.second, static_cast<uint64_t>(kvp.second) * (kvp.first.size() - 1) });
+		}
+	}
+	// Ties fall back to the fragment order, so the same plans always give the same library.
+	std::stable_sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) { return a.saved > b.saved; });
+
+	std::vector<Action*> steps;
+	for (const Candidate& candidate : candidates)
+	{
+		if (library.macros.size() >= options.maxMacros)
+		{
+			break;
+		}
+
+		steps.clear();
+		for (const uint32_t index : *candidate.fragment)
+		{
+			steps.push_back(primitives[index]);
+		}
+
+		MacroAction& macro = library.macros.emplace_back();
+		bool keep = MacroBuild(macro, steps);
+		for (size_t i = 0; keep && i < library.actions.size(); ++i)
+		{
+			keep = !MacroDominatedBy(macro.action, *library.actions[i]);
+		}
+		if (!keep)
+		{
+			library.macros.pop_back();
+			continue;
+		}
+		macro.support = candidate.support;
+		library.actions.push_back(&macro.action);
+	}
+
+	MacroLibraryRebuild(library);
+}
+
+// Returns the macro whose action is action, or nullptr for a primitive.
+inline const MacroAction* MacroFind(const MacroLibrary& library, const Action* action)
+{
+	for (const MacroAction& macro : library.macros)
+	{
+		if (&macro.action == action)
+		{
+			return &macro;
+		}
+	}
+	return nullptr;
+}
+
+// Replaces every macro in plan by its steps, in place.
+inline void MacroExpandPlan(const MacroLibrary& library, std::vector<Action*>& plan)
+{
+	size_t expandedSize = 0;
+	for (const Action* action : plan)
+	{
+		const MacroAction* macro = MacroFind(library, action);
+		expandedSize += macro != nullptr ? macro->steps.size() : 1;
+	}
+	if (expandedSize == plan.size())
+	{
+		return;
+	}
+
+	// Fill from the back so every step is written after the entry it replaces was read.
+	size_t read = plan.size();
+	plan.resize(expandedSize);
+	size_t write = expandedSize;
+	while (read > 0)
+	{
+		Action* action = plan[--read];
+		const MacroAction* macro = MacroFind(library, action);
+		if (macro == nullptr)
+		{
+			plan[--write] = action;
+			continue;
+		}
+		for (size_t i = macro->steps.size(); i > 0; --i)
+		{
+			plan[--write] = macro->steps[i - 1];
+		}
+	}
+}
+
+// Plans with the primitives and enabled macros of library; context.plan holds primitive steps only.
+template<typename TOpenList>
+inline bool PlanWithMacros(BasicPlannerContext<TOpenList>& context, const MacroLibrary& library, const Goal& goal, const WorldState& state,
+	const PlanOptions& options = {})
+{
+	if (!Plan(context, goal, state, library.table, options))
+	{
+		return false;
+	}
+	MacroExpandPlan(library, context.plan);
+	return true;
+}
+
+inline float MacroPlanCost(const std::vector<Action*>& plan)
+{
+	float cost = 0.0f;
+	for (const Action* action : plan)
+	{
+		cost += action->cost;
+	}
+	return cost;
+}
+
+// Replans every recorded query with and without macros and disables the macros used by any plan
+// that came out more expensive, until no plan does. Returns the number of macros disabled.
+inline uint32_t MacroLibraryVerify(MacroLibrary& library, const MacroMiner& miner, const PlanOptions& options = {})
+{
+	PlannerContext baseline;
+	PlannerContext withMacros;
+	uint32_t disabled = 0;
+
+	bool changed = true;
+	while (changed)
+	{
+		changed = false;
+		for (const MacroQuery& query : miner.queries)
+		{
+			const bool found = Plan(baseline, query.goal, query.state, library.primitiveTable, options);
+			if (!Plan(withMacros, query.goal, query.state, library.table, options))
+			{
+				continue;
+			}
+
+			if (!found || MacroPlanCost(withMacros.plan) <= MacroPlanCost(baseline.plan))
+			{
+				continue;
+			}
+
+			for (MacroAction& macro : library.macros)
+			{
+				if (macro.enabled && std::find(withMacros.plan.begin(), withMacros.plan.end(), &macro.action) != withMacros.plan.end())
+				{
+					macro.enabled = false;
+					disabled++;
+					changed = true;
+				}
+			}
+		}
+		if (changed)
+		{
+			MacroLibraryRebuild(library);
+		}
+	}
+	return disabled;
+}
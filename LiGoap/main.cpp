@@ -1,12 +1,169 @@
 // Michael Adaixo - 2025
 
+#include <atomic>
 #include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
 #include <iomanip>
+#include <new>
 #include <random>
 
+#include "benchmark.h"
+#include "domain_file.h"
+#include "goal_policy.h"
+#include "macro_actions.h"
+#include "plan_batch.h"
+#include "plan_service.h"
 #include "planner.h"
+#include "planner_anytime.h"
+#include "planner_incremental.h"
+#include "planner_parallel.h"
+#include "static_domain.h"
 
 #define TEST_TIME 10
+#define BATCH_TEST_TIME 2
+#define BATCH_AGENTS 512
+
+// Counts every heap allocation so we can check that planning with a warm context does not allocate.
+// Every replaceable form goes through these two, which stay out of line: inlined into the std
+// containers, GCC pairs the free() with operator new and reports a mismatched deallocation.
+static std::atomic<size_t> g_allocationCount = 0;
+
+#if defined(_MSC_VER)
+#define LIGOAP_NOINLINE __declspec(noinline)
+#else
+#define LIGOAP_NOINLINE __attribute__((noinline))
+#endif
+
+LIGOAP_NOINLINE static void* CountedAllocate(size_t size, size_t alignment) noexcept
+{
+	g_allocationCount.fetch_add(1, std::memory_order_relaxed);
+	size = size > 0 ? size : 1;
+#if defined(_MSC_VER)
+	return _aligned_malloc(size, alignment);
+#else
+	// aligned_alloc() wants a size that is a multiple of the alignment.
+	return alignment <= alignof(std::max_align_t) ? std::malloc(size) : std::aligned_alloc(alignment, (size + alignment - 1) & ~(alignment - 1));
+#endif
+}
+
+LIGOAP_NOINLINE static void CountedFree(void* ptr) noexcept
+{
+#if defined(_MSC_VER)
+	_aligned_free(ptr);
+#else
+	std::free(ptr);
+#endif
+}
+
+static void* CountedAllocateOrThrow(size_t size, size_t alignment)
+{
+	if (void* ptr = CountedAllocate(size, alignment))
+	{
+		return ptr;
+	}
+	throw std::bad_alloc();
+}
+
+constexpr size_t kDefaultAlignment = alignof(std::max_align_t);
+
+void* operator new(size_t size) { return CountedAllocateOrThrow(size, kDefaultAlignment); }
+void* operator new[](size_t size) { return CountedAllocateOrThrow(size, kDefaultAlignment); }
+void* operator new(size_t size, std::align_val_t alignment) { return CountedAllocateOrThrow(size, static_cast<size_t>(alignment)); }
+void* operator new[](size_t size, std::align_val_t alignment) { return CountedAllocateOrThrow(size, static_cast<size_t>(alignment)); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return CountedAllocate(size, kDefaultAlignment); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return CountedAllocate(size, kDefaultAlignment); }
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return CountedAllocate(size, static_cast<size_t>(alignment)); }
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return CountedAllocate(size, static_cast<size_t>(alignment)); }
+
+void operator delete(void* ptr) noexcept { CountedFree(ptr); }
+void operator delete[](void* ptr) noexcept { CountedFree(ptr); }
+void operator delete(void* ptr, size_t) noexcept { CountedFree(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { CountedFree(ptr); }
+void operator delete(void* ptr, std::align_val_t) noexcept { CountedFree(ptr); }
+void operator delete[](void* ptr, std::align_val_t) noexcept { CountedFree(ptr); }
+void operator delete(void* ptr, size_t, std::align_val_t) noexcept { CountedFree(ptr); }
+void operator delete[](void* ptr, size_t, std::align_val_t) noexcept { CountedFree(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { CountedFree(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { CountedFree(ptr); }
+void operator delete(void* ptr, std::align_val_t, const std::nothrow_t&) noexcept { CountedFree(ptr); }
+void operator delete[](void* ptr, std::align_val_t, const std::nothrow_t&) noexcept { CountedFree(ptr); }
+
+// The domain built in main(), described at compile time in the same action order.
+struct KillEnemyDomain
+{
+	static constexpr StaticAction actions[] = {
+		MakeStaticAction("Sprint", 3, {},
+			{ { EKeyAtom::kAtLocation, true }, { EKeyAtom::kStamina, false } }),
+		MakeStaticAction("Walk", 5, {},
+			{ { EKeyAtom::kAtLocation, true } }),
+		MakeStaticAction("Crouch", 1, {},
+			{ { EKeyAtom::kIsCrouched, true }, { EKeyAtom::kIsStealthy, true } }),
+		MakeStaticAction("Prone", 2, {},
+			{ { EKeyAtom::kIsProne, true }, { EKeyAtom::kIsStealthy, true }, { EKeyAtom::kAccuracyIncreased, true } }),
+		MakeStaticAction("FindCover", 2, { { EKeyAtom::kAtLocation, true } },
+			{ { EKeyAtom::kHasCover, true } }),
+		MakeStaticAction("EnterBuilding", 3, { { EKeyAtom::kAtLocation, true } },
+			{ { EKeyAtom::kInsideBuilding, true }, { EKeyAtom::kHasCover, true } }),
+		MakeStaticAction("ClimbVantagePoint", 4, { { EKeyAtom::kAtLocation, true }, { EKeyAtom::kStamina, true } },
+			{ { EKeyAtom::kHasHighGround, true }, { EKeyAtom::kAccuracyIncreased, true } }),
+		MakeStaticAction("SwitchToSidearm", 1, {},
+			{ { EKeyAtom::kWeaponArmed, true }, { EKeyAtom::kUsingPistol, true } }),
+		MakeStaticAction("SwitchToRifle", 2, { { EKeyAtom::kHasRifle, true } },
+			{ { EKeyAtom::kWeaponArmed, true }, { EKeyAtom::kUsingRifle, true } }),
+		MakeStaticAction("SwitchToSniper", 2, { { EKeyAtom::kHasSniper, true } },
+			{ { EKeyAtom::kWeaponArmed, true }, { EKeyAtom::kUsingSniper, true } }),
+		MakeStaticAction("ReloadPistol", 2, { { EKeyAtom::kUsingPistol, true }, { EKeyAtom::kHasPistolAmmo, true } },
+			{ { EKeyAtom::kWeaponLoaded, true } }),
+		MakeStaticAction("ReloadRifle", 3, { { EKeyAtom::kUsingRifle, true }, { EKeyAtom::kHasRifleAmmo, true } },
+			{ { EKeyAtom::kWeaponLoaded, true } }),
+		MakeStaticAction("ReloadSniper", 4, { { EKeyAtom::kUsingSniper, true }, { EKeyAtom::kHasSniperAmmo, true } },
+			{ { EKeyAtom::kWeaponLoaded, true } }),
+		MakeStaticAction("QuickShot", 3, { { EKeyAtom::kWeaponArmed, true }, { EKeyAtom::kWeaponLoaded, true } },
+			{ { EKeyAtom::kTargetIsDead, true }, { EKeyAtom::kWeaponLoaded, false } }),
+		MakeStaticAction("AimedShot", 5, { { EKeyAtom::kWeaponArmed, true }, { EKeyAtom::kWeaponLoaded, true }, { EKeyAtom::kAccuracyIncreased, true } },
+			{ { EKeyAtom::kTargetIsDead, true }, { EKeyAtom::kWeaponLoaded, false } }),
+		MakeStaticAction("SniperShot", 6, { { EKeyAtom::kUsingSniper, true }, { EKeyAtom::kWeaponLoaded, true }, { EKeyAtom::kHasHighGround, true } },
+			{ { EKeyAtom::kTargetIsDead, true }, { EKeyAtom::kWeaponLoaded, false } }),
+		MakeStaticAction("SearchForAmmo", 4, {},
+			{ { EKeyAtom::kHasPistolAmmo, true }, { EKeyAtom::kHasRifleAmmo, true } }),
+		MakeStaticAction("FindRifle", 3, {},
+			{ { EKeyAtom::kHasRifle, true } }),
+		MakeStaticAction("FindSniper", 5, {},
+			{ { EKeyAtom::kHasSniper, true } }),
+		MakeStaticAction("UseStim", 2, {},
+			{ { EKeyAtom::kStamina, true } }),
+		MakeStaticAction("EnterVehicle", 2, { { EKeyAtom::kAtLocation, true } },
+			{ { EKeyAtom::kInVehicle, true }, { EKeyAtom::kHasCover, true } }),
+		MakeStaticAction("StartVehicle", 1, { { EKeyAtom::kInVehicle, true } },
+			{ { EKeyAtom::kVehicleRunning, true } }),
+		MakeStaticAction("DriveVehicle", 3, { { EKeyAtom::kInVehicle, true }, { EKeyAtom::kVehicleRunning, true } },
+			{ { EKeyAtom::kAtLocation, true } }),
+		MakeStaticAction("CallSupport", 4, { { EKeyAtom::kHasRadio, true } },
+			{ { EKeyAtom::kSupportAvailable, true } }),
+		MakeStaticAction("MarkTarget", 2, { { EKeyAtom::kHasHighGround, true } },
+			{ { EKeyAtom::kTargetMarked, true } }),
+		MakeStaticAction("CallAirstrike", 8, { { EKeyAtom::kSupportAvailable, true }, { EKeyAtom::kTargetMarked, true } },
+			{ { EKeyAtom::kTargetIsDead, true } }),
+		MakeStaticAction("AttackFromCover", 1, { { EKeyAtom::kHasCover, true }, { EKeyAtom::kWeaponArmed, true }, { EKeyAtom::kWeaponLoaded, true } },
+			{ { EKeyAtom::kTargetIsDead, true } }),
+		MakeStaticAction("Attack", 4, { { EKeyAtom::kWeaponArmed, true }, { EKeyAtom::kWeaponLoaded, true } },
+			{ { EKeyAtom::kTargetIsDead, true } }),
+		MakeStaticAction("AttackFromVehicle", 1, { { EKeyAtom::kAtObject, true }, { EKeyAtom::kWeaponArmed, true }, { EKeyAtom::kWeaponLoaded, true } },
+			{ { EKeyAtom::kTargetIsDead, true } }),
+		MakeStaticAction("GoTo", 2, { { EKeyAtom::kDestination, true } },
+			{ { EKeyAtom::kAtObject, true } }),
+		MakeStaticAction("UseObject", 2, { { EKeyAtom::kAtObject, true } },
+			{ { EKeyAtom::kHasCover, true } }),
+		MakeStaticAction("EquipWeapon", 1, {},
+			{ { EKeyAtom::kWeaponArmed, true } }),
+		MakeStaticAction("ReloadWeapon", 1, { { EKeyAtom::kWeaponArmed, true } },
+			{ { EKeyAtom::kWeaponLoaded, true } }),
+	};
+	static constexpr StaticGoal goal = MakeStaticGoal("KillEnemy", { { EKeyAtom::kTargetIsDead, true } });
+};
 
 struct PlannerStats
 {
@@ -14,8 +171,9 @@ struct PlannerStats
 	double plans_per_second;
 };
 
+template<typename TContext>
 PlannerStats BenchmarkPlanner(const Goal& goal, const WorldState& initial_state,
-	const std::vector<Action*>& actions,
+	const std::vector<Action*>& actions, const PlanOptions& options = {},
 	std::chrono::seconds duration = std::chrono::seconds(TEST_TIME))
 {
 	using clock = std::chrono::high_resolution_clock;
@@ -23,34 +181,16 @@ PlannerStats BenchmarkPlanner(const Goal& goal, const WorldState& initial_state,
 	const auto end_time = start_time + duration;
 
 	size_t plans_found = 0;
-	std::vector<int> best_plan;
+	TContext context;
+
+	// Compile once; the loop measures planning only.
+	ActionTable table;
+	ActionTableBuild(table, actions);
 
 	// Keep planning until time runs out
 	while (clock::now() < end_time)
 	{
-		// Create a copy of initial state for this iteration
-		WorldState current_state = initial_state;
-
-		// Add some randomization to help explore different paths
-		std::random_device rd;
-		std::mt19937 gen(rd());
-		std::uniform_real_distribution<> noise(-0.1, 0.1);
-
-		// Modify action costs slightly to explore different paths
-		std::vector<Action*> temp_actions;
-		temp_actions.reserve(actions.size());
-
-		for (const auto& action : actions)
-		{
-			Action* newAction = new Action(std::string(action->name), action->cost + static_cast<int>(noise(gen)));
-			newAction->eff = action->eff;
-			newAction->pre = action->pre;
-			temp_actions.push_back(newAction);
-		}
-
-		// Try to find a plan
-		auto plan = Plan(goal, current_state, temp_actions);
-		if (!plan.empty())
+		if (Plan(context, goal, initial_state, table, options))
 		{
 			plans_found++;
 		}
@@ -66,14 +206,684 @@ PlannerStats BenchmarkPlanner(const Goal& goal, const WorldState& initial_state,
 	};
 }
 
-void RunPlannerBenchmark(const Goal& goal, const WorldState& initial_state, const std::vector<Action*>& actions)
+template<typename TContext>
+void RunPlannerBenchmark(const char* label, const Goal& goal, const WorldState& initial_state, const std::vector<Action*>& actions,
+	const PlanOptions& options = {})
 {
-	auto stats = BenchmarkPlanner(goal, initial_state, actions);
+	auto stats = BenchmarkPlanner<TContext>(goal, initial_state, actions, options);
 
-	printf("Benchmark Results\n"
+	printf("Benchmark Results [%s]\n"
 		"Total plans found: %llu\n"
 		"Plans per second: %.2f\n",
-			stats.total_plans, stats.plans_per_second);
+			label, static_cast<unsigned long long>(stats.total_plans), stats.plans_per_second);
+}
+
+template<typename TContext>
+void PrintSearchStats(const char* label, const Goal& goal, const WorldState& initial_state, const std::vector<Action*>& actions,
+	const PlanOptions& options = {})
+{
+	TContext context;
+	Plan(context, goal, initial_state, actions, options);
+
+	const PlanStats& stats = context.stats;
+	printf("Search Stats [%s]\n"
+		"Extracted: %u Expanded: %u Generated: %u Duplicates: %u Dead ends: %u Pruned: %u Open peak: %u\n",
+			label, stats.extracted, stats.expanded, stats.generated, stats.duplicates, stats.deadEnds, stats.pruned, stats.openPeak);
+}
+
+// Plans for BATCH_AGENTS agents per batch, each starting from a slightly different
+// state, and reports batches worth of plans per second for the given worker count.
+PlannerStats BenchmarkPlanBatch(const Goal& goal, const WorldState& initial_state,
+	const std::vector<Action*>& actions, unsigned workers, PlanCache* cache = nullptr,
+	std::chrono::seconds duration = std::chrono::seconds(BATCH_TEST_TIME))
+{
+	using clock = std::chrono::high_resolution_clock;
+
+	// Vary a few facts per agent so search cost differs between requests.
+	std::mt19937 gen(1234);
+	std::uniform_int_distribution<uint64_t> fact(1, static_cast<uint64_t>(EKeyAtom::Count) - 1);
+	std::vector<PlanRequest> requests(BATCH_AGENTS);
+	for (PlanRequest& request : requests)
+	{
+		request.goal = &goal;
+		request.state = initial_state;
+		for (int i = 0; i < 3; ++i)
+		{
+			BitsetWrite(request.state.stateBits, static_cast<EKeyAtom>(fact(gen)), gen() & 1);
+		}
+	}
+
+	std::vector<PlanResult> results(BATCH_AGENTS);
+	for (PlanResult& result : results)
+	{
+		result.plan.reserve(16);
+	}
+
+	BatchPlanner<PlannerContext> batch(workers);
+	batch.cache = cache;
+
+	const auto start_time = clock::now();
+	const auto end_time = start_time + duration;
+
+	size_t plans_found = 0;
+	while (clock::now() < end_time)
+	{
+		PlanBatch(batch, requests.data(), requests.size(), actions, results.data());
+		for (const PlanResult& result : results)
+		{
+			plans_found += result.found ? 1 : 0;
+		}
+	}
+
+	const auto elapsed = std::chrono::duration<double>(clock::now() - start_time).count();
+	return PlannerStats{
+		plans_found,
+		static_cast<double>(plans_found) / elapsed
+	};
+}
+
+void RunPlanBatchScaling(const Goal& goal, const WorldState& initial_state, const std::vector<Action*>& actions)
+{
+	const unsigned maxWorkers = std::max(1u, std::thread::hardware_concurrency());
+
+	printf("Batch Scaling (%d agents per batch)\n", BATCH_AGENTS);
+	// Powers of two, then the full machine.
+	std::vector<unsigned> workerCounts;
+	for (unsigned workers = 1; workers < maxWorkers; workers *= 2)
+	{
+		workerCounts.push_back(workers);
+	}
+	workerCounts.push_back(maxWorkers);
+
+	double baseline = 0.0;
+	for (unsigned workers : workerCounts)
+	{
+		const PlannerStats stats = BenchmarkPlanBatch(goal, initial_state, actions, workers);
+		baseline = workers == 1 ? stats.plans_per_second : baseline;
+		printf("Workers: %2u Plans per second: %10.2f Speedup: %.2fx\n",
+			workers, stats.plans_per_second, stats.plans_per_second / baseline);
+	}
+}
+
+// Same batch as above, once planning every request and once through a shared plan cache.
+void RunPlanCacheBenchmark(const Goal& goal, const WorldState& initial_state, const std::vector<Action*>& actions)
+{
+	const unsigned workers = std::max(1u, std::thread::hardware_concurrency());
+	PlanCache cache(BATCH_AGENTS);
+
+	const PlannerStats uncached = BenchmarkPlanBatch(goal, initial_state, actions, workers);
+	const PlannerStats cached = BenchmarkPlanBatch(goal, initial_state, actions, workers, &cache);
+	const PlanCacheStats cacheStats = PlanCacheGetStats(cache);
+
+	printf("Plan Cache (%d agents per batch)\n"
+		"Uncached plans per second: %10.2f\n"
+		"Cached plans per second:   %10.2f\n"
+		"Hits: %llu Misses: %llu Evictions: %llu Invalidations: %llu\n",
+			BATCH_AGENTS, uncached.plans_per_second, cached.plans_per_second,
+			static_cast<unsigned long long>(cacheStats.hits), static_cast<unsigned long long>(cacheStats.misses),
+			static_cast<unsigned long long>(cacheStats.evictions), static_cast<unsigned long long>(cacheStats.invalidations));
+}
+
+// Spreads one search over frames with a fixed node budget per frame.
+void RunTimeSlicedPlan(const Goal& goal, const WorldState& initial_state, const std::vector<Action*>& actions, uint32_t nodesPerFrame)
+{
+	PlannerContext context;
+	std::vector<Action*> partial;
+
+	int frames = 0;
+	EPlanStatus status = PlanStart(context, goal, initial_state, actions);
+	while (status == EPlanStatus::InProgress)
+	{
+		status = PlanStep(context, nodesPerFrame);
+		frames++;
+	}
+	PlanGetPartialPlan(context, partial);
+
+	printf("Time sliced (%u nodes per frame)\n"
+		"Frames: %d Found: %s Plan length: %zu\n",
+			nodesPerFrame, frames, status == EPlanStatus::Found ? "yes" : "no", partial.size());
+}
+
+// Executes the plan step by step while the world keeps changing, replanning after every step
+// with the incremental planner and, for comparison, from scratch.
+void RunIncrementalReplan(const Goal& goal, const WorldState& initial_state, const std::vector<Action*>& actions)
+{
+	IncrementalPlanner incremental;
+	WorldState state = initial_state;
+
+	printf("Incremental replanning\n");
+	for (int step = 0; step < 4; ++step)
+	{
+		PlannerContext scratch;
+		PlanOptions regressive;
+		regressive.direction = EPlanDirection::Regressive;
+		Plan(scratch, goal, state, actions, regressive);
+
+		const bool found = PlanIncremental(incremental, goal, state, actions);
+		const IncrementalStats& stats = incremental.stats;
+		printf("Query %d: Found: %s Expanded: %u Re-expanded: %u Reused: %u (from scratch: %u)\n",
+			step, found ? "yes" : "no", stats.expanded, stats.reExpanded, stats.reused, scratch.stats.expanded);
+		if (!found || incremental.plan.empty())
+		{
+			break;
+		}
+
+		// Execute the first action, then let the world undo part of it.
+		ActionApplyEffect(*incremental.plan.front(), state);
+		BitsetWrite(state.stateBits, EKeyAtom::kWeaponLoaded, false);
+	}
+}
+
+// Builds the goal's policy table over the states reachable from a seeded set of starts, round-trips
+// it through a temporary file, then compares answering from the mapped table with searching.
+void RunGoalPolicy(const Goal& goal, const WorldState& initial_state, const std::vector<Action*>& actions)
+{
+	const std::string path = (std::filesystem::temp_directory_path() / "LiGoap.policy").string();
+	const int iterations = 100000;
+
+	ActionTable table;
+	ActionTableBuild(table, actions);
+
+	std::vector<WorldState> starts;
+	BenchmarkMakeStarts(starts, 27, initial_state, static_cast<uint32_t>(EKeyAtom::Count) - 1, 256, 4);
+	starts.push_back(initial_state);
+
+	GoalPolicy built;
+	const auto buildStart = std::chrono::high_resolution_clock::now();
+	if (!GoalPolicyBuild(built, goal, table, starts))
+	{
+		printf("Goal policy: too many relevant facts or reachable states\n");
+		return;
+	}
+	const std::chrono::duration<double, std::milli> buildTime = std::chrono::high_resolution_clock::now() - buildStart;
+
+	GoalPolicy policy;
+	const auto loadStart = std::chrono::high_resolution_clock::now();
+	const bool loaded = GoalPolicySave(built, path.c_str()) && GoalPolicyLoad(policy, path.c_str());
+	const std::chrono::duration<double, std::milli> loadTime = std::chrono::high_resolution_clock::now() - loadStart;
+	if (!loaded)
+	{
+		printf("Goal policy: could not write %s\n", path.c_str());
+		std::remove(path.c_str());
+		return;
+	}
+
+	PlannerContext context;
+	const auto searchStart = std::chrono::high_resolution_clock::now();
+	for (int i = 0; i < iterations; ++i)
+	{
+		Plan(context, goal, initial_state, table);
+	}
+	const std::chrono::duration<double> searchTime = std::chrono::high_resolution_clock::now() - searchStart;
+	const size_t searchLength = context.plan.size();
+
+	const auto lookupStart = std::chrono::high_resolution_clock::now();
+	for (int i = 0; i < iterations; ++i)
+	{
+		PlanWithPolicy(context, policy, goal, initial_state, table);
+	}
+	const std::chrono::duration<double> lookupTime = std::chrono::high_resolution_clock::now() - lookupStart;
+
+	printf("Goal policy (%u facts, %u entries, %zu bytes, built in %.2f ms, saved and mapped in %.2f ms)\n"
+		"Searched plans per second: %12.2f (length %zu)\n"
+		"Policy plans per second:   %12.2f (length %zu)\n",
+			policy.header->factCount, policy.header->entryCount, policy.file.size(), buildTime.count(), loadTime.count(),
+			iterations / searchTime.count(), searchLength, iterations / lookupTime.count(), context.plan.size());
+
+	// Unmapped first: a mapped file cannot be removed on every platform.
+	policy.file.close();
+	std::remove(path.c_str());
+}
+
+// Compiles the domain to a domain file, maps it back and plans with the mapped table.
+void RunDomainFile(const Goal& goal, const WorldState& initial_state, const std::vector<Action*>& actions)
+{
+	const std::string path = (std::filesystem::temp_directory_path() / "LiGoap.lgd").string();
+	const int loads = 1000;
+
+	DomainFile built;
+	if (!DomainBuild(built, actions, { &goal }) || !DomainSave(built, path.c_str()))
+	{
+		printf("Domain file: could not write %s\n", path.c_str());
+		std::remove(path.c_str());
+		return;
+	}
+
+	DomainFile domain;
+	const auto loadStart = std::chrono::high_resolution_clock::now();
+	for (int i = 0; i < loads; ++i)
+	{
+		DomainLoad(domain, path.c_str());
+	}
+	const std::chrono::duration<double, std::micro> loadTime = std::chrono::high_resolution_clock::now() - loadStart;
+
+	Goal mappedGoal;
+	if (!DomainValid(domain) || !DomainGetGoal(domain, goal.name.c_str(), mappedGoal))
+	{
+		printf("Domain file: could not load %s\n", path.c_str());
+		DomainClear(domain);
+		std::remove(path.c_str());
+		return;
+	}
+
+	PlannerContext context;
+	Plan(context, goal, initial_state, actions);
+	float cost = 0.0f;
+	for (const Action* action : context.plan)
+	{
+		cost += action->cost;
+	}
+
+	PlannerContext mapped;
+	const bool found = Plan(mapped, mappedGoal, initial_state, domain.table);
+	float mappedCost = 0.0f;
+	for (const Action* action : mapped.plan)
+	{
+		mappedCost += action->cost;
+	}
+
+	printf("Domain file (%u actions, %u goals, %u facts, %llu bytes)\n"
+		"Load: %.2f us Found: %s Cost: %.0f (in-code domain: %.0f)\n"
+		"Plan:",
+			domain.header->actionCount, domain.header->goalCount, domain.header->factCount,
+			static_cast<unsigned long long>(domain.header->fileSize), loadTime.count() / loads,
+			found ? "yes" : "no", mappedCost, cost);
+	for (const Action* action : mapped.plan)
+	{
+		printf(" %s", DomainActionName(domain, action));
+	}
+	printf("\n");
+
+	// Unmapped first: a mapped file cannot be removed on every platform.
+	DomainClear(domain);
+	std::remove(path.c_str());
+}
+
+// Seeded, reproducible scenario set for regression tracking: the hand-written domain, then generated
+// domains of growing fact and action counts. Prints a table and writes the same numbers to jsonPath.
+int RunBenchmarkSuite(const Goal& goal, const WorldState& initial_state, const std::vector<Action*>& actions, const char* jsonPath)
+{
+	const uint32_t seed = 2025;
+	const uint32_t keyCount = static_cast<uint32_t>(EKeyAtom::Count) - 1;
+
+	struct SyntheticSize
+	{
+		uint32_t facts;
+		uint32_t actions;
+	};
+	const SyntheticSize sizes[] = { { 16, 32 }, { 24, 48 }, { 32, 64 }, { 40, 96 }, { 48, 128 } };
+
+	std::vector<BenchmarkScenario> scenarios;
+
+	BenchmarkScenario handWritten;
+	handWritten.name = "KillEnemy";
+	handWritten.goal = &goal;
+	handWritten.actions = &actions;
+	handWritten.factCount = keyCount;
+	handWritten.repetitions = 16;
+	BenchmarkMakeStarts(handWritten.starts, seed, initial_state, keyCount, 256, 3);
+	scenarios.push_back(handWritten);
+
+	handWritten.name = "KillEnemy h_max";
+	handWritten.options.heuristic = EPlanHeuristic::HMax;
+	scenarios.push_back(handWritten);
+
+	// Deque keeps the domains in place while scenarios point at them.
+	std::deque<SyntheticDomain> domains;
+	for (const SyntheticSize& size : sizes)
+	{
+		domains.emplace_back();
+		SyntheticDomain& domain = domains.back();
+		MakeSyntheticDomain(domain, seed + size.facts, size.facts, size.actions, 4);
+
+		BenchmarkScenario scenario;
+		scenario.name = "Synthetic " + std::to_string(size.facts) + "x" + std::to_string(size.actions);
+		scenario.goal = &domain.goal;
+		scenario.actions = &domain.actions;
+		scenario.factCount = size.facts;
+		scenario.repetitions = 2;
+		BenchmarkMakeStarts(scenario.starts, seed, domain.start, size.facts, 32, size.facts / 4);
+		scenarios.push_back(scenario);
+	}
+
+	std::vector<BenchmarkResult> results;
+	for (const BenchmarkScenario& scenario : scenarios)
+	{
+		results.push_back(BenchmarkRunScenario<PlannerContext>(scenario, g_allocationCount));
+	}
+
+	BenchmarkPrintResults(results);
+	if (!BenchmarkWriteJson(jsonPath, results, seed))
+	{
+		printf("Could not write %s\n", jsonPath);
+		return 1;
+	}
+	printf("Results written to %s\n", jsonPath);
+	return 0;
+}
+
+// Records one KillEnemy search and writes it as a Chrome trace to path and as a binary log to path.bin.
+int RunTraceExport(const Goal& goal, const WorldState& initial_state, const std::vector<Action*>& actions, const char* path)
+{
+#if defined(LIGOAP_TRACE)
+	PlannerContext context;
+	const bool found = Plan(context, goal, initial_state, actions);
+
+	const std::string binaryPath = std::string(path) + ".bin";
+	if (!PlanTraceWriteChrome(context.trace, context.stats, path) || !PlanTraceWriteBinary(context.trace, context.stats, binaryPath.c_str()))
+	{
+		printf("Could not write %s\n", path);
+		return 1;
+	}
+
+	printf("Found: %s Events: %zu Dropped: %u\n"
+		"Trace written to %s and %s\n",
+			found ? "yes" : "no", context.trace.records.size(), context.trace.dropped, path, binaryPath.c_str());
+	return 0;
+#else
+	(void)goal;
+	(void)initial_state;
+	(void)actions;
+	printf("Trace export needs a build with LIGOAP_TRACE defined (%s not written)\n", path);
+	return 1;
+#endif
+}
+
+// Agents asking the planning service for plans, a few of them changing their mind before their
+// job starts. Most agents share a start state, so their requests coalesce into one search.
+void RunPlanService(const Goal& goal, const WorldState& initial_state, const std::vector<Action*>& actions)
+{
+	PlanService service(std::max(1u, std::thread::hardware_concurrency()));
+	const uint32_t actionSet = PlanServiceAddActions(service, actions);
+
+	std::vector<std::future<PlanServiceResult>> results;
+	for (uint32_t agent = 0; agent < BATCH_AGENTS; ++agent)
+	{
+		PlanServiceRequest request;
+		request.goal = &goal;
+		request.state = initial_state;
+		request.actionSet = actionSet;
+		request.agent = agent;
+		request.priority = agent % 4;
+		BitsetWrite(request.state.stateBits, EKeyAtom::kWeaponLoaded, agent % 8 == 0);
+		results.push_back(PlanServiceSubmit(service, request));
+
+		// Every 16th agent sees its state change and submits again, superseding the first request.
+		if (agent % 16 == 0)
+		{
+			BitsetWrite(request.state.stateBits, EKeyAtom::kWeaponArmed, true);
+			results.push_back(PlanServiceSubmit(service, request));
+		}
+	}
+
+	uint32_t found = 0;
+	uint32_t cancelled = 0;
+	for (std::future<PlanServiceResult>& result : results)
+	{
+		const EPlanServiceStatus status = result.get().status;
+		found += status == EPlanServiceStatus::Found ? 1 : 0;
+		cancelled += status == EPlanServiceStatus::Cancelled ? 1 : 0;
+	}
+
+	const PlanServiceMetrics metrics = PlanServiceGetMetrics(service);
+	printf("Plan service (%d agents)\n"
+		"Found: %u Cancelled: %u Submitted: %llu Coalesced: %llu Superseded: %llu Searches: %llu\n"
+		"Queue peak: %u Wait mean: %.3f ms Wait max: %.3f ms\n",
+			BATCH_AGENTS, found, cancelled, static_cast<unsigned long long>(metrics.submitted),
+			static_cast<unsigned long long>(metrics.coalesced), static_cast<unsigned long long>(metrics.superseded),
+			static_cast<unsigned long long>(metrics.completed), metrics.queuePeak, metrics.waitMeanMs, metrics.waitMaxMs);
+}
+
+// Mines macros from the plans of one set of start states, then plans another set with and
+// without them to compare search effort and plan cost.
+void RunMacroActions(const Goal& goal, const WorldState& initial_state, const std::vector<Action*>& actions)
+{
+	const uint32_t factCount = static_cast<uint32_t>(EKeyAtom::Count) - 1;
+	std::vector<WorldState> mined;
+	std::vector<WorldState> queries;
+	BenchmarkMakeStarts(mined, 25, initial_state, factCount, 64, 4);
+	BenchmarkMakeStarts(queries, 26, initial_state, factCount, 256, 4);
+
+	PlanOptions options;
+	PlannerContext context;
+	MacroMiner miner;
+	MacroMinerReset(miner, actions);
+	for (const WorldState& start : mined)
+	{
+		if (Plan(context, goal, start, actions, options))
+		{
+			MacroMinerRecord(miner, goal, start, context.plan);
+		}
+	}
+
+	MacroLibrary library;
+	MacroLibraryBuild(library, miner);
+	const uint32_t disabled = MacroLibraryVerify(library, miner, options);
+
+	printf("Macro actions (mined from %u plans)\n", miner.plans);
+	for (const MacroAction& macro : library.macros)
+	{
+		printf("  %-44s Cost: %d Support: %u%s\n", macro.action.name.c_str(), macro.action.cost, macro.support, macro.enabled ? "" : " (disabled)");
+	}
+
+	uint64_t expanded = 0;
+	uint64_t macroExpanded = 0;
+	float cost = 0.0f;
+	float macroCost = 0.0f;
+	uint32_t found = 0;
+	for (const WorldState& start : queries)
+	{
+		if (Plan(context, goal, start, library.primitiveTable, options))
+		{
+			expanded += context.stats.expanded;
+			cost += MacroPlanCost(context.plan);
+			found++;
+		}
+		if (PlanWithMacros(context, library, goal, start, options))
+		{
+			macroExpanded += context.stats.expanded;
+			macroCost += MacroPlanCost(context.plan);
+		}
+	}
+	printf("Disabled: %u Queries: %zu Found: %u\n"
+		"Expanded: %llu -> %llu Total cost: %.0f -> %.0f\n",
+			disabled, queries.size(), found, static_cast<unsigned long long>(expanded), static_cast<unsigned long long>(macroExpanded),
+			cost, macroCost);
+}
+
+// Runtime planner against the compile-time specialised one on the same queries, one heuristic at a time.
+template<EPlanHeuristic Kind>
+void RunStaticDomain(const char* label, const Goal& goal, const WorldState& initial_state, const std::vector<Action*>& actions)
+{
+	using clock = std::chrono::high_resolution_clock;
+	const uint32_t passes = 2000;
+
+	std::vector<WorldState> starts;
+	BenchmarkMakeStarts(starts, 23, initial_state, static_cast<uint32_t>(EKeyAtom::Count) - 1, 64, 4);
+
+	ActionTable table;
+	ActionTableBuild(table, actions);
+
+	PlanOptions options;
+	options.heuristic = Kind;
+	PlanOptions relevant = options;
+	relevant.goalRelevance = true;
+
+	PlannerContext context;
+	StaticPlannerContext staticContext;
+
+	// Same answers first: both searches must agree on reachability and plan cost.
+	uint32_t mismatches = 0;
+	for (const WorldState& start : starts)
+	{
+		const bool found = Plan(context, goal, start, table, options);
+		const bool staticFound = Plan<KillEnemyDomain, Kind>(staticContext, start);
+		float cost = 0.0f;
+		float staticCost = 0.0f;
+		for (const Action* action : context.plan)
+		{
+			cost += action->cost;
+		}
+		for (const StaticAction* action : staticContext.plan)
+		{
+			staticCost += action->cost;
+		}
+		mismatches += found != staticFound || cost != staticCost ? 1 : 0;
+	}
+
+	auto measure = [&](auto&& plan)
+	{
+		const auto begin = clock::now();
+		for (uint32_t pass = 0; pass < passes; ++pass)
+		{
+			for (const WorldState& start : starts)
+			{
+				plan(start);
+			}
+		}
+		return static_cast<double>(passes * starts.size()) / std::chrono::duration<double>(clock::now() - begin).count();
+	};
+
+	const double runtime = measure([&](const WorldState& start) { Plan(context, goal, start, table, options); });
+	const double runtimeRelevant = measure([&](const WorldState& start) { Plan(context, goal, start, table, relevant); });
+	const double specialised = measure([&](const WorldState& start) { Plan<KillEnemyDomain, Kind>(staticContext, start); });
+
+	printf("Static domain [%s] (%zu of %zu actions relevant, %zu facts, %u mismatches)\n"
+		"Runtime plans per second:                 %12.2f\n"
+		"Runtime, goal relevance plans per second: %12.2f\n"
+		"Plan<KillEnemyDomain> plans per second:   %12.2f (%.2fx)\n",
+			label, StaticDomainTables<KillEnemyDomain>::kActionCount, std::size(KillEnemyDomain::actions),
+			StaticDomainTables<KillEnemyDomain>::kFactCount, mismatches,
+			runtime, runtimeRelevant, specialised, specialised / runtimeRelevant);
+}
+
+// One large search, serial and then split over a growing number of HDA* workers.
+void RunParallelScaling()
+{
+	const unsigned maxWorkers = std::max(1u, std::thread::hardware_concurrency());
+
+	SyntheticDomain domain;
+	MakeSyntheticDomain(domain, 11, 40, 120, 8);
+
+	ActionTable table;
+	ActionTableBuild(table, domain.actions);
+
+	PlanOptions options;
+	options.heuristic = EPlanHeuristic::HMax;
+
+	PlannerContext context;
+	const auto serialStart = std::chrono::high_resolution_clock::now();
+	const bool found = Plan(context, domain.goal, domain.start, table, options);
+	const std::chrono::duration<double, std::milli> serialTime = std::chrono::high_resolution_clock::now() - serialStart;
+
+	float serialCost = 0.0f;
+	for (const Action* action : context.plan)
+	{
+		serialCost += action->cost;
+	}
+
+	printf("Parallel search (synthetic domain, 40 facts, 120 actions)\n"
+		"Serial:     %8.2f ms Found: %s Cost: %.0f Expanded: %u\n",
+			serialTime.count(), found ? "yes" : "no", serialCost, context.stats.expanded);
+
+	std::vector<unsigned> workerCounts;
+	for (unsigned workers = 1; workers < maxWorkers; workers *= 2)
+	{
+		workerCounts.push_back(workers);
+	}
+	workerCounts.push_back(maxWorkers);
+
+	for (unsigned workers : workerCounts)
+	{
+		ParallelPlanner planner(workers);
+		const auto start = std::chrono::high_resolution_clock::now();
+		const bool parallelFound = PlanParallel(planner, domain.goal, domain.start, table, options);
+		const std::chrono::duration<double, std::milli> time = std::chrono::high_resolution_clock::now() - start;
+
+		float cost = 0.0f;
+		for (const Action* action : planner.plan)
+		{
+			cost += action->cost;
+		}
+
+		printf("Workers %2u: %8.2f ms Found: %s Cost: %.0f Expanded: %u Messages: %llu Speedup: %.2fx\n",
+			workers, time.count(), parallelFound ? "yes" : "no", cost, planner.stats.expanded,
+			static_cast<unsigned long long>(planner.messages), serialTime.count() / time.count());
+	}
+}
+
+// One search on a synthetic domain at several A* weights, then ARA* improving its plan in
+// fixed slices. h_max is admissible, so every reported bound holds.
+void RunWeightedSearch()
+{
+	SyntheticDomain domain;
+	MakeSyntheticDomain(domain, 11, 40, 120, 8);
+
+	ActionTable table;
+	ActionTableBuild(table, domain.actions);
+
+	PlanOptions options;
+	options.heuristic = EPlanHeuristic::HMax;
+
+	printf("Weighted search (synthetic domain, 40 facts, 120 actions)\n");
+	PlannerContext context;
+	for (const float weight : { 1.0f, 1.5f, 2.5f, 5.0f })
+	{
+		options.weight = weight;
+		const auto start = std::chrono::high_resolution_clock::now();
+		const bool found = Plan(context, domain.goal, domain.start, table, options);
+		const std::chrono::duration<double, std::milli> time = std::chrono::high_resolution_clock::now() - start;
+
+		float cost = 0.0f;
+		for (const Action* action : context.plan)
+		{
+			cost += action->cost;
+		}
+		printf("Weight %.1f: %8.2f ms Found: %s Cost: %.0f Bound: %.2f Expanded: %u\n",
+			weight, time.count(), found ? "yes" : "no", cost, context.search.bound, context.stats.expanded);
+	}
+
+	AnytimePlanner anytime;
+	options.weight = 5.0f;
+	const uint32_t nodesPerSlice = 20;
+
+	uint32_t solutions = 0;
+	int slices = 0;
+	EPlanStatus status = AnytimePlanStart(anytime, domain.goal, domain.start, table, options, 1.0f);
+	while (status == EPlanStatus::InProgress)
+	{
+		status = AnytimePlanStep(anytime, nodesPerSlice);
+		slices++;
+		if (anytime.solutions != solutions)
+		{
+			solutions = anytime.solutions;
+			printf("Anytime slice %3d: Cost: %.0f Bound: %.2f Expanded: %u\n", slices, anytime.planCost, anytime.bound, anytime.stats.expanded);
+		}
+	}
+	printf("Anytime (%u nodes per slice): %s after %d slices\n", nodesPerSlice, status == EPlanStatus::Found ? "optimal" : "failed", slices);
+}
+
+void CheckSteadyStateAllocations(const Goal& goal, const WorldState& initial_state, const std::vector<Action*>& actions)
+{
+	const int iterations = 1000;
+
+	// Warm up so every buffer in the context reaches its working size.
+	PlannerContext context;
+	Plan(context, goal, initial_state, actions);
+
+	const size_t allocationsBefore = g_allocationCount.load(std::memory_order_relaxed);
+	uint32_t growCount = 0;
+	for (int i = 0; i < iterations; ++i)
+	{
+		Plan(context, goal, initial_state, actions);
+		growCount += context.growCount;
+	}
+	const size_t allocations = g_allocationCount.load(std::memory_order_relaxed) - allocationsBefore;
+
+	printf("Steady state\n"
+		"Allocations per plan: %.2f\n"
+		"Context buffer growths: %u\n",
+			static_cast<double>(allocations) / iterations, growCount);
 }
 
 int main(int argc, char* argv[])
@@ -276,6 +1086,8 @@ int main(int argc, char* argv[])
 	actions.push_back(&equipWeapon);
 	actions.push_back(&reloadWeapon);
 
+	ActionsFinalize(actions);
+
 	WorldState currentState;
 	BitsetInit(currentState.stateBits);
 	
@@ -295,7 +1107,76 @@ int main(int argc, char* argv[])
 	BitsetWrite(currentState.stateBits, EKeyAtom::kHasCover, false);
 	BitsetWrite(currentState.stateBits, EKeyAtom::kIsStealthy, false);
 
-	RunPlannerBenchmark(killEnemy, currentState, actions);
+	// LiGoap --bench [results.json] runs only the benchmark suite.
+	if (argc > 1 && std::strcmp(argv[1], "--bench") == 0)
+	{
+		return RunBenchmarkSuite(killEnemy, currentState, actions, argc > 2 ? argv[2] : "benchmark.json");
+	}
+
+	// LiGoap --compile-domain <domain.goap> <domain.lgd> compiles a text domain into a domain file.
+	if (argc > 1 && std::strcmp(argv[1], "--compile-domain") == 0)
+	{
+		std::string error;
+		if (argc < 4 || !DomainCompileFile(argv[2], argv[3], error))
+		{
+			printf("Domain compile failed: %s\n", argc < 4 ? "usage: --compile-domain <domain.goap> <domain.lgd>" : error.c_str());
+			return 1;
+		}
+		return 0;
+	}
+
+	// LiGoap --trace [trace.json] records a single search.
+	if (argc > 1 && std::strcmp(argv[1], "--trace") == 0)
+	{
+		return RunTraceExport(killEnemy, currentState, actions, argc > 2 ? argv[2] : "plan_trace.json");
+	}
+
+	RunPlannerBenchmark<PlannerContext>("BinaryHeap", killEnemy, currentState, actions);
+	RunPlannerBenchmark<BucketPlannerContext>("BucketQueue", killEnemy, currentState, actions);
+	RunPlannerBenchmark<IndexedPlannerContext>("IndexedDaryHeap", killEnemy, currentState, actions);
+	PrintSearchStats<PlannerContext>("BinaryHeap", killEnemy, currentState, actions);
+	PrintSearchStats<BucketPlannerContext>("BucketQueue", killEnemy, currentState, actions);
+	PrintSearchStats<IndexedPlannerContext>("IndexedDaryHeap", killEnemy, currentState, actions);
+
+	PlanOptions regressive;
+	regressive.direction = EPlanDirection::Regressive;
+	RunPlannerBenchmark<PlannerContext>("BinaryHeap, Regressive", killEnemy, currentState, actions, regressive);
+	PrintSearchStats<PlannerContext>("BinaryHeap, Regressive", killEnemy, currentState, actions, regressive);
+
+	PlanOptions hMax;
+	hMax.heuristic = EPlanHeuristic::HMax;
+	RunPlannerBenchmark<PlannerContext>("BinaryHeap, h_max", killEnemy, currentState, actions, hMax);
+	PrintSearchStats<PlannerContext>("BinaryHeap, h_max", killEnemy, currentState, actions, hMax);
+
+	PlanOptions hAdd;
+	hAdd.heuristic = EPlanHeuristic::HAdd;
+	RunPlannerBenchmark<PlannerContext>("BinaryHeap, h_add", killEnemy, currentState, actions, hAdd);
+	PrintSearchStats<PlannerContext>("BinaryHeap, h_add", killEnemy, currentState, actions, hAdd);
+
+	PlanOptions relevant;
+	relevant.goalRelevance = true;
+	RunPlannerBenchmark<PlannerContext>("BinaryHeap, goal relevance", killEnemy, currentState, actions, relevant);
+	PrintSearchStats<PlannerContext>("BinaryHeap, goal relevance", killEnemy, currentState, actions, relevant);
+
+	PlanOptions partialOrder;
+	partialOrder.partialOrderReduction = true;
+	RunPlannerBenchmark<PlannerContext>("BinaryHeap, partial order", killEnemy, currentState, actions, partialOrder);
+	PrintSearchStats<PlannerContext>("BinaryHeap, partial order", killEnemy, currentState, actions, partialOrder);
+
+	CheckSteadyStateAllocations(killEnemy, currentState, actions);
+	RunTimeSlicedPlan(killEnemy, currentState, actions, 4);
+	RunIncrementalReplan(killEnemy, currentState, actions);
+	RunGoalPolicy(killEnemy, currentState, actions);
+	RunDomainFile(killEnemy, currentState, actions);
+	RunMacroActions(killEnemy, currentState, actions);
+	RunStaticDomain<EPlanHeuristic::GoalCount>("GoalCount", killEnemy, currentState, actions);
+	RunStaticDomain<EPlanHeuristic::HMax>("h_max", killEnemy, currentState, actions);
+	RunPlanBatchScaling(killEnemy, currentState, actions);
+	RunPlanService(killEnemy, currentState, actions);
+	RunParallelScaling();
+	RunWeightedSearch();
+	printf("\n");
+	RunPlanCacheBenchmark(killEnemy, currentState, actions);
 
 	BitsetPrint(currentState.stateBits);
 	std::vector<Action*> plan = Plan(killEnemy, currentState, actions);
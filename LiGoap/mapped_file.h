@@ -0,0 +1,136 @@
+// Michael Adaixo - 2025
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "types.h"
+
+// MAPPED FILE: Read-only memory mapping of a whole file.
+// The contents are paged in on first touch, so loading a large table costs nothing up front.
+class MappedFile : NoCopy {
+public:
+	MappedFile() = default;
+
+	~MappedFile()
+	{
+		close();
+	}
+
+	// Maps path. Returns false, leaving the object empty, when the file cannot be opened or is empty.
+	bool open(const char* path)
+	{
+		close();
+
+#if defined(_WIN32)
+		file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+		{
+			return false;
+		}
+
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+		{
+			close();
+			return false;
+		}
+
+		mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (mapping == nullptr)
+		{
+			close();
+			return false;
+		}
+
+		view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		if (view == nullptr)
+		{
+			close();
+			return false;
+		}
+		bytes = static_cast<size_t>(fileSize.QuadPart);
+#else
+		const int fd = ::open(path, O_RDONLY);
+		if (fd < 0)
+		{
+			return false;
+		}
+
+		struct stat info;
+		if (fstat(fd, &info) != 0 || info.st_size == 0)
+		{
+			::close(fd);
+			return false;
+		}
+
+		// The mapping keeps its own reference to the file, so the descriptor can go right away.
+		void* address = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+		::close(fd);
+		if (address == MAP_FAILED)
+		{
+			return false;
+		}
+
+		view = address;
+		bytes = static_cast<size_t>(info.st_size);
+#endif
+		return true;
+	}
+
+	void close()
+	{
+#if defined(_WIN32)
+		if (view != nullptr)
+		{
+			UnmapViewOfFile(view);
+		}
+		if (mapping != nullptr)
+		{
+			CloseHandle(mapping);
+		}
+		if (file != INVALID_HANDLE_VALUE)
+		{
+			CloseHandle(file);
+		}
+		mapping = nullptr;
+		file = INVALID_HANDLE_VALUE;
+#else
+		if (view != nullptr)
+		{
+			munmap(view, bytes);
+		}
+#endif
+		view = nullptr;
+		bytes = 0;
+	}
+
+	bool isOpen() const { return view != nullptr; }
+	const uint8_t* data() const { return static_cast<const uint8_t*>(view); }
+	size_t size() const { return bytes; }
+
+private:
+	void* view = nullptr;
+	size_t bytes = 0;
+
+#if defined(_WIN32)
+	HANDLE file = INVALID_HANDLE_VALUE;
+	HANDLE mapping = nullptr;
+#endif
+};
@@ -0,0 +1,174 @@
+// Michael Adaixo - 2025
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "action_table.h"
+#include "heuristic.h"
+
+// True when running a can make b inapplicable: an effect of a contradicts a precondition of b.
+inline bool PartialOrderDisables(const ActionTable& table, size_t a, size_t b)
+{
+	const bitset_t falseRequired = table.preMask[b] & ~table.preValue[b];
+	const bitset_t trueRequired = table.preValue[b];
+	return BitsetAny((table.effSet[a] & falseRequired) | (table.effClear[a] & trueRequired));
+}
+
+// Actions a and b commute unless one disables the other or they write opposite values to a fact.
+// Commuting actions applicable in the same state reach the same state at the same cost in either order.
+inline bool PartialOrderInterfere(const ActionTable& table, size_t a, size_t b)
+{
+	return PartialOrderDisables(table, a, b) || PartialOrderDisables(table, b, a)
+		|| BitsetAny((table.effSet[a] & table.effClear[b]) | (table.effClear[a] & table.effSet[b]));
+}
+
+// PARTIAL ORDER TABLE: Interference relation and achiever lists of an action set, used to
+// compute strong stubborn sets. Expanding only the applicable actions of a stubborn set skips
+// every ordering of commuting actions but one, as well as actions that cannot contribute to
+// the goal from the current state, without losing optimal plans. Because the set depends only
+// on the state and not on the path that reached it, the reduction stays safe with the closed list.
+struct PartialOrderTable
+{
+	uint64_t actionSignature = 0;
+	bool prepared = false;
+
+	// Compressed lists: entries [start[i], start[i + 1]) belong to action or literal i
+	std::vector<uint32_t> interferenceStart;
+	std::vector<uint32_t> interference;  // Actions that interfere with each action
+	std::vector<uint32_t> achieverStart;
+	std::vector<uint32_t> achievers;     // Actions whose effects make each literal true
+
+	// Scratch for PartialOrderStubbornSet
+	std::vector<uint32_t> stamp; // Action is in the current set when stamp matches stampValue
+	uint32_t stampValue = 0;
+	std::vector<uint32_t> worklist;
+	std::vector<uint64_t> allowed; // One bit per action, kActionTableBlock actions per word
+};
+
+// Rebuilds the tables unless they were already built for this action set.
+inline void PartialOrderPrepare(PartialOrderTable& order, const ActionTable& table)
+{
+	if (order.prepared && order.actionSignature == table.signature)
+	{
+		return;
+	}
+
+	const size_t count = ActionTableSize(table);
+
+	order.interferenceStart.clear();
+	order.interference.clear();
+	for (size_t a = 0; a < count; ++a)
+	{
+		order.interferenceStart.push_back(static_cast<uint32_t>(order.interference.size()));
+		for (size_t b = 0; b < count; ++b)
+		{
+			if (a != b && PartialOrderInterfere(table, a, b))
+			{
+				order.interference.push_back(static_cast<uint32_t>(b));
+			}
+		}
+	}
+	order.interferenceStart.push_back(static_cast<uint32_t>(order.interference.size()));
+
+	order.achieverStart.clear();
+	order.achievers.clear();
+	for (size_t literal = 0; literal < kRelaxedLiteralCount; ++literal)
+	{
+		order.achieverStart.push_back(static_cast<uint32_t>(order.achievers.size()));
+
+		const uint32_t bit = static_cast<uint32_t>(literal / 2);
+		const bool value = (literal & 1) == 0;
+		for (size_t a = 0; a < count; ++a)
+		{
+			if (BitsetTest(value ? table.effSet[a] : table.effClear[a], bit))
+			{
+				order.achievers.push_back(static_cast<uint32_t>(a));
+			}
+		}
+	}
+	order.achieverStart.push_back(static_cast<uint32_t>(order.achievers.size()));
+
+	order.stamp.assign(count, 0);
+	order.stampValue = 0;
+	order.worklist.reserve(count);
+	order.allowed.assign((count + kActionTableBlock - 1) / kActionTableBlock, 0);
+
+	order.actionSignature = table.signature;
+	order.prepared = true;
+}
+
+inline void PartialOrderPush(PartialOrderTable& order, uint32_t action)
+{
+	if (order.stamp[action] != order.stampValue)
+	{
+		order.stamp[action] = order.stampValue;
+		order.worklist.push_back(action);
+	}
+}
+
+inline void PartialOrderPushAchievers(PartialOrderTable& order, uint32_t bit, bool value)
+{
+	const uint32_t literal = RelaxedLiteral(bit, value);
+	for (uint32_t i = order.achieverStart[literal]; i < order.achieverStart[literal + 1]; ++i)
+	{
+		PartialOrderPush(order, order.achievers[i]);
+	}
+}
+
+// Computes a strong stubborn set for state and writes its applicable actions to order.allowed.
+// Seeded with the achievers of one unsatisfied goal fact, then closed under: interfering actions
+// for applicable members, and achievers of one unsatisfied precondition for inapplicable ones.
+// state must not satisfy the goal.
+inline void PartialOrderStubbornSet(PartialOrderTable& order, const ActionTable& table, const bitset_t& state,
+	const bitset_t& goalCare, const bitset_t& goalValue)
+{
+	if (++order.stampValue == 0)
+	{
+		// Stamp wrapped; clear old tags so none look current.
+		std::fill(order.stamp.begin(), order.stamp.end(), 0u);
+		order.stampValue = 1;
+	}
+	std::fill(order.allowed.begin(), order.allowed.end(), 0ull);
+	order.worklist.clear();
+
+	// One unsatisfied goal fact is enough: every plan has to achieve it.
+	bool seeded = false;
+	BitsetForEach((state ^ goalValue) & goalCare, [&](uint32_t bit)
+	{
+		if (!seeded)
+		{
+			PartialOrderPushAchievers(order, bit, BitsetTest(goalValue, bit));
+			seeded = true;
+		}
+	});
+
+	while (!order.worklist.empty())
+	{
+		const uint32_t action = order.worklist.back();
+		order.worklist.pop_back();
+
+		const bitset_t unmet = (state ^ table.preValue[action]) & table.preMask[action];
+		if (!BitsetAny(unmet))
+		{
+			order.allowed[action / kActionTableBlock] |= 1ull << (action % kActionTableBlock);
+			for (uint32_t i = order.interferenceStart[action]; i < order.interferenceStart[action + 1]; ++i)
+			{
+				PartialOrderPush(order, order.interference[i]);
+			}
+			continue;
+		}
+
+		bool pushed = false;
+		BitsetForEach(unmet, [&](uint32_t bit)
+		{
+			if (!pushed)
+			{
+				PartialOrderPushAchievers(order, bit, BitsetTest(table.preValue[action], bit));
+				pushed = true;
+			}
+		});
+	}
+}
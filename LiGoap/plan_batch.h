@@ -0,0 +1,74 @@
+// Michael Adaixo - 2025
+
+#pragma once
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "plan_cache.h"
+#include "planner.h"
+#include "thread_pool.h"
+
+// One agent's planning query. All requests of a batch share the same action set.
+struct PlanRequest
+{
+	const Goal* goal;
+	WorldState state;
+};
+
+// Output slot for one request. Keep the vector reserved between batches so
+// writing the plan does not allocate.
+struct PlanResult
+{
+	std::vector<Action*> plan;
+	PlanStats stats;
+	bool found;
+};
+
+// BATCH PLANNER: Worker pool plus one planner context per worker.
+// Construct once and reuse; the contexts keep their memory between batches.
+template<typename TContext = PlannerContext>
+struct BatchPlanner : NoCopy
+{
+	explicit BatchPlanner(unsigned workers = std::thread::hardware_concurrency())
+		: pool(workers)
+	{
+		contexts.reserve(pool.workerCount());
+		for (unsigned i = 0; i < pool.workerCount(); ++i)
+		{
+			contexts.push_back(std::make_unique<TContext>());
+		}
+	}
+
+	WorkStealingPool pool;
+	std::vector<std::unique_ptr<TContext>> contexts;
+	ActionTable actionTable; // Shared by every worker during a batch
+	PlanCache* cache = nullptr; // Optional; consulted before every search when set
+};
+
+// Plans every request in parallel and writes result i for request i.
+// results must point to at least count elements.
+template<typename TContext>
+inline void PlanBatch(BatchPlanner<TContext>& batch, const PlanRequest* requests, size_t count,
+	const std::vector<Action*>& actions, PlanResult* results, const PlanOptions& options = {})
+{
+	// Searches are short, so hand out a few at a time to keep stealing cheap.
+	const size_t grain = 4;
+
+	ActionTableBuild(batch.actionTable, actions);
+	const ActionTable& table = batch.actionTable;
+
+	batch.pool.parallelFor(count, grain, [&](unsigned worker, size_t index)
+	{
+		TContext& context = *batch.contexts[worker];
+		const PlanRequest& request = requests[index];
+		PlanResult& result = results[index];
+
+		result.found = batch.cache != nullptr
+			? PlanCached(*batch.cache, context, *request.goal, request.state, table, options)
+			: Plan(context, *request.goal, request.state, table, options);
+		result.plan.assign(context.plan.begin(), context.plan.end());
+		result.stats = context.stats;
+	});
+}
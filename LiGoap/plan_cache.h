@@ -0,0 +1,300 @@
+// Michael Adaixo - 2025
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "action_table.h"
+#include "goal.h"
+#include "goal_relevance.h"
+#include "planner.h"
+
+// Cache key: the goal plus the start state reduced to the facts that can influence the plan.
+struct PlanCacheKey
+{
+	bitset_t goalCare;
+	bitset_t goalValue;
+	bitset_t stateBits; // Start state masked by the goal's relevant facts
+	uint32_t options;   // Search direction and heuristic, which may pick different plans
+	float weight;       // PlanOptions::weight; weighted searches may return costlier plans
+
+	bool operator==(const PlanCacheKey& other) const
+	{
+		return goalCare == other.goalCare && goalValue == other.goalValue && stateBits == other.stateBits
+			&& options == other.options && weight == other.weight;
+	}
+};
+
+struct PlanCacheKeyHash
+{
+	size_t operator()(const PlanCacheKey& key) const noexcept
+	{
+		uint64_t hash = BitsetHash(key.goalCare);
+		hash = StateHashMix(hash ^ BitsetHash(key.goalValue));
+		hash = StateHashMix(hash ^ BitsetHash(key.stateBits) ^ key.options);
+		hash = StateHashMix(hash ^ static_cast<uint64_t>(key.weight * 1024.0f));
+		return static_cast<size_t>(hash);
+	}
+};
+
+constexpr uint32_t kPlanCacheNone = UINT32_MAX;
+
+// Cached search result. Plans are stored as action table indices, so an entry stays
+// usable with any table of the same signature even if the Action objects moved.
+struct PlanCacheEntry
+{
+	PlanCacheKey key;
+	std::vector<uint32_t> plan;
+	bool found;
+
+	// Recency list, most recently used first
+	uint32_t prev;
+	uint32_t next;
+};
+
+// One independently locked slice of the cache. Entries are spread over shards by key
+// hash so batch workers looking up different keys rarely wait on each other.
+struct alignas(64) PlanCacheShard
+{
+	std::mutex mutex;
+	std::unordered_map<PlanCacheKey, uint32_t, PlanCacheKeyHash> index;
+	std::vector<PlanCacheEntry> entries;
+	uint32_t head = kPlanCacheNone;
+	uint32_t tail = kPlanCacheNone;
+	uint32_t capacity = 0;
+	uint64_t signature = 0; // ActionTable signature the entries were computed with
+};
+
+constexpr size_t kPlanCacheShards = 16;
+
+struct PlanCacheStats
+{
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t evictions;
+	uint64_t invalidations; // Shards flushed because the action set or its costs changed
+};
+
+// PLAN CACHE: Bounded LRU map from (goal, relevant start facts) to the plan found for them.
+// Only facts that the goal or an action able to reach it can read are part of the key,
+// so changes to unrelated facts still hit. Safe to share between the threads of a batch.
+// Entries are dropped as soon as a table with a different signature is used.
+struct PlanCache : NoCopy
+{
+	explicit PlanCache(size_t capacity = 1024)
+	{
+		const size_t perShard = std::max<size_t>(1, (capacity + kPlanCacheShards - 1) / kPlanCacheShards);
+		for (PlanCacheShard& shard : shards)
+		{
+			shard.capacity = static_cast<uint32_t>(perShard);
+			shard.entries.reserve(perShard);
+			shard.index.reserve(perShard);
+		}
+	}
+
+	PlanCacheShard shards[kPlanCacheShards];
+
+	// Shared by every thread, so only touched under relevanceMutex
+	std::mutex relevanceMutex;
+	GoalRelevanceCache relevance;
+
+	std::atomic<uint64_t> hits{ 0 };
+	std::atomic<uint64_t> misses{ 0 };
+	std::atomic<uint64_t> evictions{ 0 };
+	std::atomic<uint64_t> invalidations{ 0 };
+};
+
+// Copy of the GoalRelevance masks the cache needs, taken while the analysis is locked.
+struct PlanCacheRelevance
+{
+	bitset_t facts;
+	bitset_t needTrue;
+	bitset_t needFalse;
+};
+
+inline PlanCacheRelevance PlanCacheGetRelevance(PlanCache& cache, const ActionTable& table, const bitset_t& goalCare, const bitset_t& goalValue)
+{
+	std::lock_guard<std::mutex> lock(cache.relevanceMutex);
+	const GoalRelevance& relevance = GoalRelevanceGet(cache.relevance, table, goalCare, goalValue);
+	return { relevance.facts, relevance.needTrue, relevance.needFalse };
+}
+
+inline PlanCacheShard& PlanCacheGetShard(PlanCache& cache, const PlanCacheKey& key)
+{
+	// The low bits pick the hash map bucket; take the shard from the high ones.
+	const uint64_t hash = PlanCacheKeyHash()(key);
+	return cache.shards[(hash >> 59) % kPlanCacheShards];
+}
+
+inline void PlanCacheUnlink(PlanCacheShard& shard, uint32_t index)
+{
+	PlanCacheEntry& entry = shard.entries[index];
+	(entry.prev != kPlanCacheNone ? shard.entries[entry.prev].next : shard.head) = entry.next;
+	(entry.next != kPlanCacheNone ? shard.entries[entry.next].prev : shard.tail) = entry.prev;
+}
+
+inline void PlanCachePushFront(PlanCacheShard& shard, uint32_t index)
+{
+	PlanCacheEntry& entry = shard.entries[index];
+	entry.prev = kPlanCacheNone;
+	entry.next = shard.head;
+	(shard.head != kPlanCacheNone ? shard.entries[shard.head].prev : shard.tail) = index;
+	shard.head = index;
+}
+
+// Drops the shard's entries when they were computed for a different action set. Shard lock must be held.
+inline void PlanCacheValidate(PlanCache& cache, PlanCacheShard& shard, const ActionTable& table)
+{
+	if (shard.signature == table.signature)
+	{
+		return;
+	}
+
+	if (!shard.entries.empty())
+	{
+		cache.invalidations.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	shard.index.clear();
+	shard.entries.clear();
+	shard.head = kPlanCacheNone;
+	shard.tail = kPlanCacheNone;
+	shard.signature = table.signature;
+}
+
+// Looks up key. On a hit writes the cached plan to outPlan and outFound, and returns true.
+inline bool PlanCacheLookup(PlanCache& cache, const PlanCacheKey& key, const ActionTable& table, std::vector<Action*>& outPlan, bool& outFound)
+{
+	PlanCacheShard& shard = PlanCacheGetShard(cache, key);
+	std::lock_guard<std::mutex> lock(shard.mutex);
+	PlanCacheValidate(cache, shard, table);
+
+	const auto it = shard.index.find(key);
+	if (it == shard.index.end())
+	{
+		cache.misses.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	const uint32_t index = it->second;
+	PlanCacheUnlink(shard, index);
+	PlanCachePushFront(shard, index);
+
+	const PlanCacheEntry& entry = shard.entries[index];
+	outPlan.clear();
+	for (const uint32_t action : entry.plan)
+	{
+		outPlan.push_back(table.actions[action]);
+	}
+	outFound = entry.found;
+
+	cache.hits.fetch_add(1, std::memory_order_relaxed);
+	return true;
+}
+
+// Stores the result of planning for key, evicting the least recently used entry when the shard is full.
+// Actions outside the goal's relevant set are left out of the stored plan: their preconditions may read
+// facts outside the key, and dropping them never makes the plan invalid or more expensive.
+inline void PlanCacheStore(PlanCache& cache, const PlanCacheKey& key, const PlanCacheRelevance& relevance, const ActionTable& table,
+	const std::vector<Action*>& plan, bool found)
+{
+	PlanCacheShard& shard = PlanCacheGetShard(cache, key);
+	std::lock_guard<std::mutex> lock(shard.mutex);
+	PlanCacheValidate(cache, shard, table);
+
+	uint32_t index;
+	const auto it = shard.index.find(key);
+	if (it != shard.index.end())
+	{
+		// Another thread planned the same key meanwhile; refresh it.
+		index = it->second;
+		PlanCacheUnlink(shard, index);
+	}
+	else if (shard.entries.size() < shard.capacity)
+	{
+		index = static_cast<uint32_t>(shard.entries.size());
+		shard.entries.emplace_back();
+		shard.index.emplace(key, index);
+	}
+	else
+	{
+		index = shard.tail;
+		PlanCacheUnlink(shard, index);
+		shard.index.erase(shard.entries[index].key);
+		shard.index.emplace(key, index);
+		cache.evictions.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	PlanCacheEntry& entry = shard.entries[index];
+	entry.key = key;
+	entry.found = found;
+	entry.plan.clear();
+	for (const Action* action : plan)
+	{
+		if (!BitsetAny((action->effSet & relevance.needTrue) | (action->effClear & relevance.needFalse)))
+		{
+			continue;
+		}
+
+		const auto position = std::find(table.actions.begin(), table.actions.end(), action);
+		entry.plan.push_back(static_cast<uint32_t>(position - table.actions.begin()));
+	}
+
+	PlanCachePushFront(shard, index);
+}
+
+inline void PlanCacheClear(PlanCache& cache)
+{
+	for (PlanCacheShard& shard : cache.shards)
+	{
+		std::lock_guard<std::mutex> lock(shard.mutex);
+		shard.index.clear();
+		shard.entries.clear();
+		shard.head = kPlanCacheNone;
+		shard.tail = kPlanCacheNone;
+	}
+
+	std::lock_guard<std::mutex> lock(cache.relevanceMutex);
+	cache.relevance = {};
+}
+
+inline PlanCacheStats PlanCacheGetStats(const PlanCache& cache)
+{
+	PlanCacheStats stats;
+	stats.hits = cache.hits.load(std::memory_order_relaxed);
+	stats.misses = cache.misses.load(std::memory_order_relaxed);
+	stats.evictions = cache.evictions.load(std::memory_order_relaxed);
+	stats.invalidations = cache.invalidations.load(std::memory_order_relaxed);
+	return stats;
+}
+
+// Plan() behind the cache. On a hit context.plan receives the cached plan and
+// context.stats are zeroed, since no search ran.
+template<typename TOpenList>
+inline bool PlanCached(PlanCache& cache, BasicPlannerContext<TOpenList>& context, const Goal& goal, const WorldState& state,
+	const ActionTable& actions, const PlanOptions& options = {})
+{
+	PlanCacheKey key;
+	GoalGetMasks(goal, key.goalCare, key.goalValue);
+
+	const PlanCacheRelevance relevance = PlanCacheGetRelevance(cache, actions, key.goalCare, key.goalValue);
+	key.stateBits = state.stateBits & relevance.facts;
+	key.options = static_cast<uint32_t>(options.direction) << 16 | static_cast<uint32_t>(options.heuristic);
+	key.weight = options.weight;
+
+	bool found;
+	if (PlanCacheLookup(cache, key, actions, context.plan, found))
+	{
+		context.stats = {};
+		return found;
+	}
+
+	found = Plan(context, goal, state, actions, options);
+	PlanCacheStore(cache, key, relevance, actions, context.plan, found);
+	return found;
+}
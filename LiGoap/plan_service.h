@@ -0,0 +1,480 @@
+// Michael Adaixo - 2025
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "action_table.h"
+#include "goal.h"
+#include "planner.h"
+
+constexpr uint32_t kPlanServiceNoAgent = UINT32_MAX;
+
+// One query for the service. The goal is copied at submission; the action set is a handle
+// returned by PlanServiceAddActions().
+struct PlanServiceRequest
+{
+	const Goal* goal = nullptr;
+	WorldState state;
+	uint32_t actionSet = 0;
+	uint32_t agent = kPlanServiceNoAgent; // A different newer request from the same agent cancels this one until it starts
+	int priority = 0;                     // Higher runs first; equal priorities run in submission order
+	bool useDeadline = false;             // Give up once deadline passes, before or during the search
+	std::chrono::steady_clock::time_point deadline;
+	PlanOptions options;
+};
+
+enum class EPlanServiceStatus
+{
+	Found,
+	Failed,    // Goal unreachable
+	Cancelled, // Superseded by a different newer request of the same agent, or the service shut down
+	Expired,   // Deadline passed; plan holds the best partial plan when the search had started
+};
+
+struct PlanServiceResult
+{
+	EPlanServiceStatus status = EPlanServiceStatus::Cancelled;
+	std::vector<Action*> plan;
+	PlanStats stats = {};
+	double waitMs = 0.0; // Time between submission and the start of the search
+};
+
+using PlanServiceCallback = std::function<void(const PlanServiceResult&)>;
+
+struct PlanServiceMetrics
+{
+	uint64_t submitted;
+	uint64_t coalesced;  // Requests attached to an identical pending job instead of queuing their own
+	uint64_t superseded; // Requests cancelled by a different newer request of the same agent
+	uint64_t completed;  // Jobs that ran, whatever their outcome
+	uint64_t expired;
+	uint32_t queueDepth; // Jobs waiting for a worker now
+	uint32_t queuePeak;
+	double waitMeanMs;   // Over started jobs
+	double waitMaxMs;
+};
+
+// Identity of a job: requests with equal keys get the same plan and share one search.
+struct PlanServiceKey
+{
+	bitset_t goalCare;
+	bitset_t goalValue;
+	bitset_t stateBits;
+	uint32_t actionSet;
+	uint32_t options;
+	float weight;
+
+	bool operator==(const PlanServiceKey& other) const
+	{
+		return goalCare == other.goalCare && goalValue == other.goalValue && stateBits == other.stateBits
+			&& actionSet == other.actionSet && options == other.options && weight == other.weight;
+	}
+};
+
+struct PlanServiceKeyHash
+{
+	size_t operator()(const PlanServiceKey& key) const noexcept
+	{
+		uint64_t hash = BitsetHash(key.goalCare);
+		hash = StateHashMix(hash ^ BitsetHash(key.goalValue));
+		hash = StateHashMix(hash ^ BitsetHash(key.stateBits));
+		hash = StateHashMix(hash ^ (static_cast<uint64_t>(key.actionSet) << 32 | key.options));
+		hash = StateHashMix(hash ^ static_cast<uint64_t>(key.weight * 1024.0f));
+		return static_cast<size_t>(hash);
+	}
+};
+
+// Whoever is waiting on a job: a promise behind a future, or a callback.
+struct PlanServiceWaiter
+{
+	uint32_t agent;
+	std::promise<PlanServiceResult> promise;
+	PlanServiceCallback callback; // Used instead of the promise when set
+};
+
+enum class EPlanServiceJobState
+{
+	Pending,
+	Running,
+	Cancelled,
+};
+
+struct PlanServiceJob
+{
+	PlanServiceKey key;
+	Goal goal;
+	WorldState start;
+	PlanOptions options;
+	int priority;
+	bool useDeadline; // Only when every waiter has one; the job then runs until the latest
+	std::chrono::steady_clock::time_point deadline;
+	std::chrono::steady_clock::time_point submitted;
+	EPlanServiceJobState state = EPlanServiceJobState::Pending;
+	std::vector<PlanServiceWaiter> waiters;
+};
+
+// Queue entry. Raising a pending job's priority pushes another entry; entries whose job is no
+// longer pending, or that carry an outdated priority, are skipped when popped.
+struct PlanServiceEntry
+{
+	int priority;
+	uint64_t sequence;
+	std::shared_ptr<PlanServiceJob> job;
+
+	// std::push_heap keeps the largest on top: higher priority, then older
+	bool operator<(const PlanServiceEntry& other) const
+	{
+		return priority < other.priority || (priority == other.priority && sequence > other.sequence);
+	}
+};
+
+struct PlanService;
+inline void PlanServiceWorkerLoop(PlanService& service);
+
+// PLAN SERVICE: Plans off the calling thread. Requests go into a priority queue drained by
+// dedicated workers, each with its own planner context. Identical pending requests share one
+// search, and a request still waiting when its agent submits a different one is cancelled; the same
+// query again joins the waiting job and keeps its place in the queue. C++17 has no
+// coroutines, so results come back through std::future or a callback run on the worker thread.
+struct PlanService : NoCopy
+{
+	explicit PlanService(unsigned workers = std::max(1u, std::thread::hardware_concurrency()))
+	{
+		const unsigned count = workers > 0 ? workers : 1;
+		threads.reserve(count);
+		for (unsigned i = 0; i < count; ++i)
+		{
+			threads.emplace_back([this]() { PlanServiceWorkerLoop(*this); });
+		}
+	}
+
+	// Pending requests are resolved as Cancelled; running searches finish first.
+	~PlanService()
+	{
+		std::vector<PlanServiceWaiter> cancelled;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+			for (PlanServiceEntry& entry : queue)
+			{
+				if (entry.job->state == EPlanServiceJobState::Pending)
+				{
+					entry.job->state = EPlanServiceJobState::Cancelled;
+					std::move(entry.job->waiters.begin(), entry.job->waiters.end(), std::back_inserter(cancelled));
+				}
+			}
+			queue.clear();
+		}
+		wake.notify_all();
+
+		for (std::thread& thread : threads)
+		{
+			thread.join();
+		}
+
+		PlanServiceResult result;
+		for (PlanServiceWaiter& waiter : cancelled)
+		{
+			waiter.callback ? waiter.callback(result) : waiter.promise.set_value(result);
+		}
+	}
+
+	std::mutex mutex;
+	std::condition_variable wake;
+	bool stopping = false;
+
+	std::vector<PlanServiceEntry> queue; // Heap, see PlanServiceEntry
+	uint64_t sequence = 0;
+	std::unordered_map<PlanServiceKey, std::shared_ptr<PlanServiceJob>, PlanServiceKeyHash> pending;
+	std::unordered_map<uint32_t, std::shared_ptr<PlanServiceJob>> agents; // Last job of each agent
+
+	// Workers take a reference at job start, so replacing a set never disturbs a running search.
+	std::vector<std::shared_ptr<const ActionTable>> actionSets;
+
+	PlanServiceMetrics metrics = {};
+	uint64_t started = 0;
+	double waitTotalMs = 0.0;
+
+	std::vector<std::thread> threads;
+};
+
+// Registers an action set and returns its handle. actions must outlive the service.
+inline uint32_t PlanServiceAddActions(PlanService& service, const std::vector<Action*>& actions)
+{
+	auto table = std::make_shared<ActionTable>();
+	ActionTableBuild(*table, actions);
+
+	std::lock_guard<std::mutex> lock(service.mutex);
+	service.actionSets.push_back(std::move(table));
+	return static_cast<uint32_t>(service.actionSets.size() - 1);
+}
+
+// Replaces the actions behind handle, e.g. after costs changed. Jobs that have not started use the new set.
+inline void PlanServiceSetActions(PlanService& service, uint32_t handle, const std::vector<Action*>& actions)
+{
+	auto table = std::make_shared<ActionTable>();
+	ActionTableBuild(*table, actions);
+
+	std::lock_guard<std::mutex> lock(service.mutex);
+	service.actionSets[handle] = std::move(table);
+}
+
+inline void PlanServicePush(PlanService& service, const std::shared_ptr<PlanServiceJob>& job)
+{
+	service.queue.push_back({ job->priority, service.sequence++, job });
+	std::push_heap(service.queue.begin(), service.queue.end());
+}
+
+// Detaches agent's waiter from its pending job when the job answers another key, cancelling the
+// job once nobody waits on it. A job for the same key is left alone so the new request joins it.
+// Service lock must be held; the waiter is moved to outCancelled to be resolved after unlocking.
+inline void PlanServiceSupersede(PlanService& service, uint32_t agent, const PlanServiceKey& key, std::vector<PlanServiceWaiter>& outCancelled)
+{
+	const auto it = service.agents.find(agent);
+	if (it == service.agents.end())
+	{
+		return;
+	}
+
+	const std::shared_ptr<PlanServiceJob> job = it->second;
+	if (job->state == EPlanServiceJobState::Pending && job->key == key)
+	{
+		return;
+	}
+	service.agents.erase(it);
+	if (job->state != EPlanServiceJobState::Pending)
+	{
+		return;
+	}
+
+	auto& waiters = job->waiters;
+	for (auto waiter = waiters.begin(); waiter != waiters.end(); )
+	{
+		if (waiter->agent == agent)
+		{
+			outCancelled.push_back(std::move(*waiter));
+			waiter = waiters.erase(waiter);
+			service.metrics.superseded++;
+		}
+		else
+		{
+			++waiter;
+		}
+	}
+
+	if (waiters.empty())
+	{
+		job->state = EPlanServiceJobState::Cancelled;
+		service.pending.erase(job->key);
+		service.metrics.queueDepth--;
+	}
+}
+
+inline void PlanServiceEnqueue(PlanService& service, const PlanServiceRequest& request, PlanServiceWaiter&& waiter)
+{
+	PlanServiceKey key;
+	GoalGetMasks(*request.goal, key.goalCare, key.goalValue);
+	key.stateBits = request.state.stateBits;
+	key.actionSet = request.actionSet;
+	key.options = static_cast<uint32_t>(request.options.direction) << 16 | static_cast<uint32_t>(request.options.heuristic) << 8
+		| (request.options.partialOrderReduction ? 2u : 0u) | (request.options.goalRelevance ? 1u : 0u);
+	key.weight = request.options.weight;
+
+	std::vector<PlanServiceWaiter> cancelled;
+	{
+		std::lock_guard<std::mutex> lock(service.mutex);
+		service.metrics.submitted++;
+
+		if (request.agent != kPlanServiceNoAgent)
+		{
+			PlanServiceSupersede(service, request.agent, key, cancelled);
+		}
+
+		std::shared_ptr<PlanServiceJob>& job = service.pending[key];
+		if (job)
+		{
+			service.metrics.coalesced++;
+			job->useDeadline = job->useDeadline && request.useDeadline;
+			job->deadline = std::max(job->deadline, request.deadline);
+			if (request.priority > job->priority)
+			{
+				job->priority = request.priority;
+				PlanServicePush(service, job);
+			}
+		}
+		else
+		{
+			job = std::make_shared<PlanServiceJob>();
+			job->key = key;
+			job->goal = *request.goal;
+			job->start = request.state;
+			job->options = request.options;
+			job->priority = request.priority;
+			job->useDeadline = request.useDeadline;
+			job->deadline = request.deadline;
+			job->submitted = std::chrono::steady_clock::now();
+			PlanServicePush(service, job);
+
+			service.metrics.queueDepth++;
+			service.metrics.queuePeak = std::max(service.metrics.queuePeak, service.metrics.queueDepth);
+		}
+
+		if (request.agent != kPlanServiceNoAgent)
+		{
+			service.agents[request.agent] = job;
+		}
+		job->waiters.push_back(std::move(waiter));
+	}
+	service.wake.notify_one();
+
+	PlanServiceResult result;
+	for (PlanServiceWaiter& superseded : cancelled)
+	{
+		superseded.callback ? superseded.callback(result) : superseded.promise.set_value(result);
+	}
+}
+
+// Queues request and returns a future for its result.
+inline std::future<PlanServiceResult> PlanServiceSubmit(PlanService& service, const PlanServiceRequest& request)
+{
+	PlanServiceWaiter waiter;
+	waiter.agent = request.agent;
+	std::future<PlanServiceResult> future = waiter.promise.get_future();
+	PlanServiceEnqueue(service, request, std::move(waiter));
+	return future;
+}
+
+// Queues request; callback runs on the worker thread that planned it. A superseded request's
+// callback runs on the thread that superseded it, and requests pending at shutdown on the destroying thread.
+inline void PlanServiceSubmit(PlanService& service, const PlanServiceRequest& request, PlanServiceCallback callback)
+{
+	PlanServiceWaiter waiter;
+	waiter.agent = request.agent;
+	waiter.callback = std::move(callback);
+	PlanServiceEnqueue(service, request, std::move(waiter));
+}
+
+inline PlanServiceMetrics PlanServiceGetMetrics(PlanService& service)
+{
+	std::lock_guard<std::mutex> lock(service.mutex);
+	PlanServiceMetrics metrics = service.metrics;
+	metrics.waitMeanMs = service.started > 0 ? service.waitTotalMs / static_cast<double>(service.started) : 0.0;
+	return metrics;
+}
+
+// Pops the next pending job, or returns null once the service stops. Service lock must be held.
+inline std::shared_ptr<PlanServiceJob> PlanServiceTakeJob(PlanService& service, std::unique_lock<std::mutex>& lock)
+{
+	for (;;)
+	{
+		service.wake.wait(lock, [&service]() { return service.stopping || !service.queue.empty(); });
+		if (service.stopping)
+		{
+			return nullptr;
+		}
+
+		std::pop_heap(service.queue.begin(), service.queue.end());
+		PlanServiceEntry entry = std::move(service.queue.back());
+		service.queue.pop_back();
+
+		PlanServiceJob& job = *entry.job;
+		if (job.state != EPlanServiceJobState::Pending || entry.priority != job.priority)
+		{
+			continue; // Cancelled, or a stale entry from before a priority raise
+		}
+
+		job.state = EPlanServiceJobState::Running;
+		service.pending.erase(job.key);
+		for (const PlanServiceWaiter& waiter : job.waiters)
+		{
+			const auto agent = service.agents.find(waiter.agent);
+			if (agent != service.agents.end() && agent->second == entry.job)
+			{
+				service.agents.erase(agent);
+			}
+		}
+		service.metrics.queueDepth--;
+		return std::move(entry.job);
+	}
+}
+
+inline void PlanServiceWorkerLoop(PlanService& service)
+{
+	PlannerContext context;
+
+	for (;;)
+	{
+		std::shared_ptr<PlanServiceJob> job;
+		std::shared_ptr<const ActionTable> actions;
+		PlanServiceResult result;
+		{
+			std::unique_lock<std::mutex> lock(service.mutex);
+			job = PlanServiceTakeJob(service, lock);
+			if (!job)
+			{
+				return;
+			}
+			actions = service.actionSets[job->key.actionSet];
+
+			const std::chrono::duration<double, std::milli> wait = std::chrono::steady_clock::now() - job->submitted;
+			result.waitMs = wait.count();
+			service.started++;
+			service.waitTotalMs += result.waitMs;
+			service.metrics.waitMaxMs = std::max(service.metrics.waitMaxMs, result.waitMs);
+		}
+
+		// The job left the pending map when it was taken, so no waiter can be added from here on.
+		if (job->useDeadline && std::chrono::steady_clock::now() >= job->deadline)
+		{
+			result.status = EPlanServiceStatus::Expired;
+		}
+		else
+		{
+			PlanBudget budget;
+			budget.useDeadline = job->useDeadline;
+			budget.deadline = job->deadline;
+
+			EPlanStatus status = PlanStart(context, job->goal, job->start, *actions, job->options);
+			if (status == EPlanStatus::InProgress)
+			{
+				status = PlanStep(context, budget);
+			}
+
+			result.stats = context.stats;
+			if (status == EPlanStatus::InProgress)
+			{
+				result.status = EPlanServiceStatus::Expired;
+				PlanGetPartialPlan(context, result.plan);
+			}
+			else
+			{
+				result.status = status == EPlanStatus::Found ? EPlanServiceStatus::Found : EPlanServiceStatus::Failed;
+				result.plan = context.plan;
+			}
+		}
+
+		std::vector<PlanServiceWaiter> waiters;
+		{
+			std::lock_guard<std::mutex> lock(service.mutex);
+			waiters = std::move(job->waiters);
+			service.metrics.completed++;
+			service.metrics.expired += result.status == EPlanServiceStatus::Expired ? 1 : 0;
+		}
+
+		for (PlanServiceWaiter& waiter : waiters)
+		{
+			waiter.callback ? waiter.callback(result) : waiter.promise.set_value(result);
+		}
+	}
+}
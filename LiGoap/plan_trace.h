@@ -0,0 +1,195 @@
+// Michael Adaixo - 2025
+
+#pragma once
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+// Search counters for the last Plan() call. Always collected; each is one increment on a path
+// that already touches the same cache lines.
+struct PlanStats
+{
+	uint32_t extracted;  // Entries popped from the open list, including stale ones
+	uint32_t expanded;   // Nodes whose successors were generated
+	uint32_t generated;  // Entries pushed or decreased in the open list
+	uint32_t duplicates; // Successors dropped because their state was already reached as cheaply
+	uint32_t deadEnds;   // Successors dropped because the heuristic proved the goal unreachable
+	uint32_t openPeak;   // Largest open list size
+	uint32_t pruned;     // Applicable actions skipped by partial-order reduction
+};
+
+// PLAN TRACE: Per-event log of one search, for finding out why a particular query is slow.
+// Only compiled in when LIGOAP_TRACE is defined: contexts then carry a PlanTrace and the
+// planner records into it through LIGOAP_TRACE_EVENT. Without it the macro expands to nothing,
+// its arguments are never evaluated, and contexts have no trace member.
+enum class EPlanTraceEvent : uint8_t
+{
+	Begin,     // PlanStart() entered
+	Prepared,  // Heuristic tables ready and the root node queued
+	Expand,    // Node popped and expanded
+	Generate,  // Successor queued
+	Duplicate, // Successor dropped by the closed list
+	DeadEnd,   // Successor dropped by the heuristic
+	Found,
+	Failed,
+	Suspended, // PlanStep() ran out of budget
+};
+
+struct PlanTraceRecord
+{
+	uint64_t timeNs; // Since the Begin record
+	uint32_t node;
+	uint32_t parent;
+	float g;
+	float h;
+	uint32_t openSize;
+	EPlanTraceEvent event;
+	uint8_t padding[3];
+};
+
+// Searches that would record more than this keep counting drops instead of growing.
+constexpr uint32_t kPlanTraceMaxRecords = 1u << 20;
+
+struct PlanTrace
+{
+	std::vector<PlanTraceRecord> records;
+	std::chrono::steady_clock::time_point origin;
+	uint32_t dropped = 0;
+};
+
+inline void PlanTraceClear(PlanTrace& trace)
+{
+	trace.records.clear();
+	trace.origin = std::chrono::steady_clock::now();
+	trace.dropped = 0;
+}
+
+inline void PlanTraceAdd(PlanTrace& trace, EPlanTraceEvent event, uint32_t node, uint32_t parent, float g, float h, size_t openSize)
+{
+	if (trace.records.size() >= kPlanTraceMaxRecords)
+	{
+		trace.dropped++;
+		return;
+	}
+
+	PlanTraceRecord record = {};
+	record.timeNs = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - trace.origin).count());
+	record.node = node;
+	record.parent = parent;
+	record.g = g;
+	record.h = h;
+	record.openSize = static_cast<uint32_t>(openSize);
+	record.event = event;
+	trace.records.push_back(record);
+}
+
+#if defined(LIGOAP_TRACE)
+#define LIGOAP_TRACE_EVENT(context, event, node, parent, g, h) \
+	PlanTraceAdd((context).trace, EPlanTraceEvent::event, (node), (parent), (g), (h), (context).openList.size())
+#else
+#define LIGOAP_TRACE_EVENT(context, event, node, parent, g, h) ((void)0)
+#endif
+
+inline const char* PlanTraceEventName(EPlanTraceEvent event)
+{
+	switch (event)
+	{
+	case EPlanTraceEvent::Begin:     return "Begin";
+	case EPlanTraceEvent::Prepared:  return "Prepared";
+	case EPlanTraceEvent::Expand:    return "Expand";
+	case EPlanTraceEvent::Generate:  return "Generate";
+	case EPlanTraceEvent::Duplicate: return "Duplicate";
+	case EPlanTraceEvent::DeadEnd:   return "DeadEnd";
+	case EPlanTraceEvent::Found:     return "Found";
+	case EPlanTraceEvent::Failed:    return "Failed";
+	case EPlanTraceEvent::Suspended: return "Suspended";
+	}
+	return "Unknown";
+}
+
+// Writes trace in the Chrome trace event format (chrome://tracing, Perfetto). The preparation and
+// search phases become duration slices, every record an instant event, and the open list size a counter.
+inline bool PlanTraceWriteChrome(const PlanTrace& trace, const PlanStats& stats, const char* path)
+{
+	FILE* out = std::fopen(path, "w");
+	if (out == nullptr)
+	{
+		return false;
+	}
+
+	uint64_t preparedNs = 0;
+	uint64_t endNs = 0;
+	for (const PlanTraceRecord& record : trace.records)
+	{
+		preparedNs = record.event == EPlanTraceEvent::Prepared ? record.timeNs : preparedNs;
+		endNs = record.timeNs;
+	}
+
+	fprintf(out, "{\"displayTimeUnit\":\"ns\",\"otherData\":{\"extracted\":%u,\"expanded\":%u,\"generated\":%u,"
+		"\"duplicates\":%u,\"deadEnds\":%u,\"openPeak\":%u,\"pruned\":%u,\"dropped\":%u},\n\"traceEvents\":[\n",
+		stats.extracted, stats.expanded, stats.generated, stats.duplicates, stats.deadEnds, stats.openPeak, stats.pruned, trace.dropped);
+	fprintf(out, "{\"name\":\"Prepare\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":0,\"dur\":%.3f},\n", preparedNs / 1000.0);
+	fprintf(out, "{\"name\":\"Search\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f}",
+		preparedNs / 1000.0, (endNs - preparedNs) / 1000.0);
+
+	for (const PlanTraceRecord& record : trace.records)
+	{
+		const double ts = record.timeNs / 1000.0;
+		// JSON has no infinity: invalid nodes and dead-end estimates are written as -1.
+		fprintf(out, ",\n{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":1,\"ts\":%.3f,"
+			"\"args\":{\"node\":%lld,\"parent\":%lld,\"g\":%g,\"h\":%g}}",
+			PlanTraceEventName(record.event), ts,
+			record.node == UINT32_MAX ? -1ll : static_cast<long long>(record.node),
+			record.parent == UINT32_MAX ? -1ll : static_cast<long long>(record.parent),
+			record.g, std::isinf(record.h) ? -1.0f : record.h);
+		if (record.event == EPlanTraceEvent::Expand)
+		{
+			fprintf(out, ",\n{\"name\":\"Open list\",\"ph\":\"C\",\"pid\":1,\"ts\":%.3f,\"args\":{\"size\":%u}}", ts, record.openSize);
+		}
+	}
+
+	fprintf(out, "\n]}\n");
+	return std::fclose(out) == 0;
+}
+
+constexpr char kPlanTraceMagic[4] = { 'L', 'G', 'T', 'R' };
+constexpr uint32_t kPlanTraceVersion = 1;
+
+// Compact form: this header followed by recordCount raw PlanTraceRecord, in native byte order.
+struct PlanTraceFileHeader
+{
+	char magic[4];
+	uint32_t version;
+	uint32_t recordSize;
+	uint32_t recordCount;
+	uint32_t dropped;
+	PlanStats stats;
+};
+
+inline bool PlanTraceWriteBinary(const PlanTrace& trace, const PlanStats& stats, const char* path)
+{
+	FILE* out = std::fopen(path, "wb");
+	if (out == nullptr)
+	{
+		return false;
+	}
+
+	PlanTraceFileHeader header = {};
+	std::memcpy(header.magic, kPlanTraceMagic, sizeof(header.magic));
+	header.version = kPlanTraceVersion;
+	header.recordSize = sizeof(PlanTraceRecord);
+	header.recordCount = static_cast<uint32_t>(trace.records.size());
+	header.dropped = trace.dropped;
+	header.stats = stats;
+
+	bool written = std::fwrite(&header, sizeof(header), 1, out) == 1;
+	if (!trace.records.empty())
+	{
+		written = written && std::fwrite(trace.records.data(), sizeof(PlanTraceRecord), trace.records.size(), out) == trace.records.size();
+	}
+	return std::fclose(out) == 0 && written;
+}
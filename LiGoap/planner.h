@@ -2,12 +2,14 @@
 
 #pragma once
 
-#include <queue>
-#include <unordered_set>
+#include <algorithm>
+#include <cstdint>
+#include <vector>
 
 #include "action.h"
 #include "goal.h"
-#include "binary_heap.h"
+#include "planner_context.h"
+#include "planner_regressive.h"
 
 inline void PlanPrint(const std::vector<Action*>& plan)
 {
@@ -19,73 +21,322 @@ inline void PlanPrint(const std::vector<Action*>& plan)
 	printf("\n");
 }
 
-inline std::vector<Action*> Plan(const Goal& goal, const WorldState& state, const std::vector<Action*>& actions)
+inline void PlanReconstruct(const std::vector<PlanNode>& nodes, uint32_t node, const std::vector<Action*>& actions, std::vector<Action*>& outPlan)
 {
-	struct PlanNode
+	outPlan.clear();
+	for (uint32_t i = node; nodes[i].parent != kInvalidPlanNode; i = nodes[i].parent)
 	{
-		std::vector<Action*> plan;
-		WorldState state;
-		float g; // current plan
-		float h; // heuristic
-		float f; // total
-
-		bool operator<(const PlanNode& Other) const { return f < Other.f; }
-		bool operator>(const PlanNode& Other) const { return f > Other.f; }
-	};
+		outPlan.push_back(actions[nodes[i].action]);
+	}
+	std::reverse(outPlan.begin(), outPlan.end());
+}
 
-	const int reserveSpace = 100;
-	BinaryHeap<PlanNode> openList(reserveSpace);
+// Seeds the forward search from context.search. Expects a reset context.
+template<typename TOpenList>
+inline EPlanStatus PlanForwardBegin(BasicPlannerContext<TOpenList>& context)
+{
+	PlanSearchState& search = context.search;
 
-	std::unordered_set<WorldState> closedList; // Visited States
+	RelaxedHeuristic& heuristic = context.heuristic;
+	RelaxedHeuristicPrepare(heuristic, search.goalCare, search.goalValue, *search.actions);
+	if (search.options.partialOrderReduction)
+	{
+		PartialOrderPrepare(context.partialOrder, *search.actions);
+	}
 
 	// Start node
-	openList.insert({ {}, state, 0, 0, GoalDistanceToState(goal, state) });
+	const float startH = RelaxedHeuristicEvaluate(heuristic, search.options.heuristic, search.start.stateBits);
+	if (startH == kHeuristicDeadEnd)
+	{
+		return EPlanStatus::Failed;
+	}
+
+	context.nodes.push_back({ search.start, kInvalidPlanNode, 0, 0.0f });
+	StateTableRelax(context.closedList, search.start, 0.0f)->node = 0;
+	context.openList.insert({ search.options.weight * startH, startH, 0 });
+
+	context.stats.generated = 1;
+	context.stats.openPeak = 1;
 
-	// Reuse these vectors to avoid allocations in the loop
-	std::vector<Action*> newPlan;
-	newPlan.reserve(15);
+	search.bestNode = 0;
+	search.bestH = startH;
+	return EPlanStatus::InProgress;
+}
+
+// Runs the forward search until the goal is reached, the open list empties or budget runs out.
+// The plan is written to context.plan.
+template<typename TOpenList>
+inline EPlanStatus PlanForwardStep(BasicPlannerContext<TOpenList>& context, const PlanBudget& budget)
+{
+	auto& openList = context.openList;
+	auto& closedList = context.closedList;
+	auto& nodes = context.nodes;
+	bitset_t* successors = context.successors;
 
-	while (!openList.empty())
+	PlanSearchState& search = context.search;
+	const ActionTable& actions = *search.actions;
+	const PlanOptions& options = search.options;
+	const bitset_t goalCare = search.goalCare;
+	const bitset_t goalValue = search.goalValue;
+	RelaxedHeuristic& heuristic = context.heuristic;
+
+	PlanStats& stats = context.stats;
+	const size_t actionCount = ActionTableSize(actions);
+
+	for (uint32_t steps = 0; !openList.empty(); ++steps)
 	{
-		PlanNode current = openList.extractMin();
+		if (PlanBudgetExhausted(budget, steps))
+		{
+			LIGOAP_TRACE_EVENT(context, Suspended, kInvalidPlanNode, kInvalidPlanNode, 0.0f, 0.0f);
+			return EPlanStatus::InProgress;
+		}
+
+		const PlanOpenEntry current = openList.extractMin();
+		stats.extracted++;
+
+		const WorldState currentState = nodes[current.node].state;
+		const float currentG = nodes[current.node].g;
 
 		// Check if goal reached
-		if (GoalDistanceToState(goal, current.state) <= 0)
+		if ((currentState.stateBits & goalCare) == goalValue)
 		{
-			return current.plan;
+			LIGOAP_TRACE_EVENT(context, Found, current.node, nodes[current.node].parent, currentG, current.h);
+			PlanReconstruct(nodes, current.node, actions.actions, context.plan);
+			search.bound = options.weight;
+			return EPlanStatus::Found;
 		}
 
-		// Add current state to closed list
-		WorldState stateKey = current.state;
-		if (closedList.find(stateKey) != closedList.end())
+		// Skip entries superseded by a cheaper path to the same state
+		if (currentG > StateTableBestG(closedList, currentState))
 		{
 			continue;
 		}
-		closedList.insert(stateKey);
+		stats.expanded++;
+		LIGOAP_TRACE_EVENT(context, Expand, current.node, nodes[current.node].parent, currentG, current.h);
 
-		// Try each action
-		for (size_t i = 0; i < actions.size(); ++i)
+		if (current.h < search.bestH)
 		{
-			Action* action = actions[i];
-			if (ActionMeetsPreconditions(*action, current.state))
+			search.bestH = current.h;
+			search.bestNode = current.node;
+		}
+
+		if (options.partialOrderReduction)
+		{
+			PartialOrderStubbornSet(context.partialOrder, actions, currentState.stateBits, goalCare, goalValue);
+		}
+
+		// Test a block of actions at once, then visit only the applicable ones
+		for (size_t first = 0; first < actionCount; first += kActionTableBlock)
+		{
+			uint64_t applicable = ActionTableScan(actions, first, currentState.stateBits, successors);
+			if (options.partialOrderReduction)
+			{
+				const uint64_t allowed = context.partialOrder.allowed[first / kActionTableBlock];
+				stats.pruned += BitsetCount(applicable & ~allowed);
+				applicable &= allowed;
+			}
+			while (applicable != 0)
 			{
-				// Create new state
-				WorldState newState = current.state;
+				const uint32_t lane = BitsetLowestBit(applicable);
+				applicable &= applicable - 1;
 
-				// Apply Action effects to new state
-				ActionApplyEffect(*action, newState);
+				const uint32_t actionIndex = static_cast<uint32_t>(first + lane);
+				const WorldState newState = { successors[lane] };
 
 				// Calculate Costs
-				const float g = current.g + static_cast<float>(action->cost); // current + movement/action cost
-				const float h = GoalDistanceToState(goal, newState);
+				const float g = currentG + actions.cost[actionIndex]; // current + movement/action cost
 
-				newPlan = current.plan;
-				newPlan.push_back(action);
+				// Drop duplicates now instead of after they went through the open list
+				StateTable::Slot* slot = StateTableRelax(closedList, newState, g);
+				if (slot == nullptr)
+				{
+					stats.duplicates++;
+					LIGOAP_TRACE_EVENT(context, Duplicate, kInvalidPlanNode, current.node, g, 0.0f);
+					continue;
+				}
 
-				openList.insert({ newPlan, newState, g, h, g + h });
+				const float h = RelaxedHeuristicEvaluate(heuristic, options.heuristic, newState.stateBits);
+				if (h == kHeuristicDeadEnd)
+				{
+					stats.deadEnds++;
+					LIGOAP_TRACE_EVENT(context, DeadEnd, kInvalidPlanNode, current.node, g, h);
+					continue;
+				}
+
+				if constexpr (TOpenList::kSupportsDecreaseKey)
+				{
+					// One node per state: reuse it so the open list can decrease its key in place.
+					if (slot->node != StateTable::kNoNode)
+					{
+						nodes[slot->node] = { newState, current.node, actionIndex, g };
+						openList.insert({ g + options.weight * h, h, slot->node });
+						stats.generated++;
+						LIGOAP_TRACE_EVENT(context, Generate, slot->node, current.node, g, h);
+						stats.openPeak = std::max(stats.openPeak, static_cast<uint32_t>(openList.size()));
+						continue;
+					}
+				}
+
+				const uint32_t newNode = static_cast<uint32_t>(nodes.size());
+				slot->node = newNode;
+				nodes.push_back({ newState, current.node, actionIndex, g });
+
+				openList.insert({ g + options.weight * h, h, newNode });
+				stats.generated++;
+				LIGOAP_TRACE_EVENT(context, Generate, newNode, current.node, g, h);
+				stats.openPeak = std::max(stats.openPeak, static_cast<uint32_t>(openList.size()));
 			}
 		}
 	}
 
+	LIGOAP_TRACE_EVENT(context, Failed, kInvalidPlanNode, kInvalidPlanNode, 0.0f, 0.0f);
+	return EPlanStatus::Failed;
+}
+
+// Resets context and seeds a search that PlanStep() advances. actions must stay alive
+// and unchanged until the search finishes.
+template<typename TOpenList>
+inline EPlanStatus PlanStart(BasicPlannerContext<TOpenList>& context, const Goal& goal, const WorldState& state, const ActionTable& actions,
+	const PlanOptions& options = {})
+{
+	PlannerContextReset(context);
+	LIGOAP_TRACE_EVENT(context, Begin, kInvalidPlanNode, kInvalidPlanNode, 0.0f, 0.0f);
+
+	PlanSearchState& search = context.search;
+	search.actions = &actions;
+	search.options = options;
+	search.start = state;
+	GoalGetMasks(goal, search.goalCare, search.goalValue);
+
+	if (options.goalRelevance)
+	{
+		// Facts outside the relevant set never influence the plan, so states that differ only
+		// there collapse into one closed list entry.
+		const GoalRelevance& relevance = GoalRelevanceGet(context.relevance, actions, search.goalCare, search.goalValue);
+		search.actions = &relevance.table;
+		search.start.stateBits = state.stateBits & relevance.facts;
+	}
+
+	search.status = options.direction == EPlanDirection::Regressive
+		? PlanRegressiveBegin(context)
+		: PlanForwardBegin(context);
+	if (search.status == EPlanStatus::InProgress)
+	{
+		LIGOAP_TRACE_EVENT(context, Prepared, 0, kInvalidPlanNode, 0.0f, search.bestH);
+	}
+	else
+	{
+		LIGOAP_TRACE_EVENT(context, Failed, kInvalidPlanNode, kInvalidPlanNode, 0.0f, kHeuristicDeadEnd);
+	}
+	return search.status;
+}
+
+// Same as above, compiling actions into the context's action table first.
+template<typename TOpenList>
+inline EPlanStatus PlanStart(BasicPlannerContext<TOpenList>& context, const Goal& goal, const WorldState& state, const std::vector<Action*>& actions,
+	const PlanOptions& options = {})
+{
+	ActionTableBuild(context.actionTable, actions);
+	return PlanStart(context, goal, state, context.actionTable, options);
+}
+
+// Advances the search started by PlanStart() within budget. Returns its status;
+// once Found or Failed, further calls return the same status without doing work.
+template<typename TOpenList>
+inline EPlanStatus PlanStep(BasicPlannerContext<TOpenList>& context, const PlanBudget& budget)
+{
+	PlanSearchState& search = context.search;
+	if (search.status != EPlanStatus::InProgress)
+	{
+		return search.status;
+	}
+
+	const PlannerContextCapacity capacity = PlannerContextGetCapacity(context);
+
+	search.status = search.options.direction == EPlanDirection::Regressive
+		? PlanRegressiveStep(context, budget)
+		: PlanForwardStep(context, budget);
+
+	context.growCount = PlannerContextCountGrowth(context, capacity);
+	return search.status;
+}
+
+// Advances the search by at most maxNodes open list entries. Deterministic for a given query.
+template<typename TOpenList>
+inline EPlanStatus PlanStep(BasicPlannerContext<TOpenList>& context, uint32_t maxNodes)
+{
+	PlanBudget budget;
+	budget.maxNodes = maxNodes;
+	return PlanStep(context, budget);
+}
+
+// Advances the search until deadline passes, see PlanBudget for the granularity.
+template<typename TOpenList>
+inline EPlanStatus PlanStep(BasicPlannerContext<TOpenList>& context, std::chrono::steady_clock::time_point deadline)
+{
+	PlanBudget budget;
+	budget.useDeadline = true;
+	budget.deadline = deadline;
+	return PlanStep(context, budget);
+}
+
+// Best plan known so far. Once Found this is the plan itself. Otherwise, for forward search,
+// a prefix leading to the expanded state the heuristic rates closest to the goal; for
+// regressive search, a suffix that reaches the goal from the closest set of requirements.
+// Returns false when no search has been started or the start already failed.
+template<typename TOpenList>
+inline bool PlanGetPartialPlan(const BasicPlannerContext<TOpenList>& context, std::vector<Action*>& outPlan)
+{
+	const PlanSearchState& search = context.search;
+	if (search.status == EPlanStatus::Found)
+	{
+		outPlan.assign(context.plan.begin(), context.plan.end());
+		return true;
+	}
+
+	if (search.bestNode == kInvalidPlanNode)
+	{
+		outPlan.clear();
+		return false;
+	}
+
+	if (search.options.direction == EPlanDirection::Regressive)
+	{
+		PlanReconstructRegressive(context.regressionNodes, search.bestNode, search.actions->actions, outPlan);
+	}
+	else
+	{
+		PlanReconstruct(context.nodes, search.bestNode, search.actions->actions, outPlan);
+	}
+	return true;
+}
+
+// Runs the search using the buffers owned by context. Returns true when a plan was found;
+// the plan itself is left in context.plan and stays valid until the next call.
+template<typename TOpenList>
+inline bool Plan(BasicPlannerContext<TOpenList>& context, const Goal& goal, const WorldState& state, const ActionTable& actions,
+	const PlanOptions& options = {})
+{
+	return PlanStart(context, goal, state, actions, options) == EPlanStatus::InProgress
+		&& PlanStep(context, PlanBudget{}) == EPlanStatus::Found;
+}
+
+// Same as above, compiling actions into the context's action table first.
+template<typename TOpenList>
+inline bool Plan(BasicPlannerContext<TOpenList>& context, const Goal& goal, const WorldState& state, const std::vector<Action*>& actions,
+	const PlanOptions& options = {})
+{
+	ActionTableBuild(context.actionTable, actions);
+	return Plan(context, goal, state, context.actionTable, options);
+}
+
+inline std::vector<Action*> Plan(const Goal& goal, const WorldState& state, const std::vector<Action*>& actions)
+{
+	PlannerContext context;
+	if (Plan(context, goal, state, actions))
+	{
+		return std::move(context.plan);
+	}
+
 	return {}; // No plan found
 }
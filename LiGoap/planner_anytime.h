@@ -0,0 +1,332 @@
+// Michael Adaixo - 2025
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include "action_table.h"
+#include "binary_heap.h"
+#include "goal.h"
+#include "goal_relevance.h"
+#include "heuristic.h"
+#include "planner_context.h"
+#include "state_table.h"
+
+// Node of the anytime search. There is one per state: a cheaper path updates the node in place.
+struct AnytimeNode
+{
+	WorldState state;
+	uint32_t parent; // kInvalidPlanNode for the start node
+	uint32_t action;
+	float g;
+	float h;
+	uint32_t closedIn;  // Iteration that last expanded the node, 0 when never
+	bool open;
+	bool inconsistent;  // Got cheaper after being expanded this iteration; reopened by the next one
+};
+
+// ANYTIME PLANNER: ARA*. Runs weighted A* with a high weight to get a first plan quickly, then
+// lowers the weight and continues from the same search tree, re-expanding only the states whose
+// cost changed, until the weight reaches 1 or the budget runs out. Every published plan is cheaper
+// than the one before and comes with a suboptimality bound; with an admissible heuristic (HMax) the
+// optimal plan costs at least planCost / bound.
+struct AnytimePlanner : NoCopy
+{
+	explicit AnytimePlanner(int reserveSpace = 256)
+		: openList(reserveSpace)
+	{
+		nodes.reserve(reserveSpace);
+		StateTableReserve(closedList, reserveSpace);
+		plan.reserve(16);
+	}
+
+	BinaryHeap<PlanOpenEntry> openList; // Entries whose node is no longer open or whose f changed are stale
+	StateTable closedList;              // Every reached state and its node
+	std::vector<AnytimeNode> nodes;
+	std::vector<uint32_t> inconsistent;
+	RelaxedHeuristic heuristic;
+	GoalRelevanceCache relevance;
+	bitset_t successors[kActionTableBlock];
+
+	// Query, kept between AnytimePlanStep() calls
+	const ActionTable* actions = nullptr;
+	PlanOptions options;
+	float weightStep = 0.5f;
+	bitset_t goalCare = {};
+	bitset_t goalValue = {};
+	float weight = 1.0f; // Weight of the current iteration
+	uint32_t iteration = 0;
+	uint32_t goalNode = kInvalidPlanNode; // Cheapest goal state reached so far
+	EPlanStatus status = EPlanStatus::Failed;
+
+	// Best plan so far. Valid once solutions > 0.
+	std::vector<Action*> plan;
+	float planCost = 0.0f;
+	float bound = 0.0f; // planCost is at most bound times the optimal cost
+	uint32_t solutions = 0;
+	PlanStats stats = {};
+};
+
+inline float AnytimePriority(const AnytimePlanner& planner, const AnytimeNode& node)
+{
+	return node.g + planner.weight * node.h;
+}
+
+inline void AnytimeOpen(AnytimePlanner& planner, uint32_t node)
+{
+	AnytimeNode& entry = planner.nodes[node];
+	entry.open = true;
+	planner.openList.insert({ AnytimePriority(planner, entry), entry.h, node });
+	planner.stats.openPeak = std::max(planner.stats.openPeak, static_cast<uint32_t>(planner.openList.size()));
+}
+
+// Records a path of cost g to state through parent. Returns false when the state was already
+// reached as cheaply or cannot reach the goal.
+inline bool AnytimeRelax(AnytimePlanner& planner, const WorldState& state, uint32_t parent, uint32_t action, float g)
+{
+	StateTable::Slot* slot = StateTableRelax(planner.closedList, state, g);
+	if (slot == nullptr)
+	{
+		planner.stats.duplicates++;
+		return false;
+	}
+
+	uint32_t node = slot->node;
+	if (node == StateTable::kNoNode)
+	{
+		const float h = RelaxedHeuristicEvaluate(planner.heuristic, planner.options.heuristic, state.stateBits);
+		node = static_cast<uint32_t>(planner.nodes.size());
+		slot->node = node;
+		planner.nodes.push_back({ state, parent, action, g, h, 0, false, false });
+	}
+
+	AnytimeNode& entry = planner.nodes[node];
+	entry.parent = parent;
+	entry.action = action;
+	entry.g = g;
+	if (entry.h == kHeuristicDeadEnd)
+	{
+		planner.stats.deadEnds++;
+		return false;
+	}
+	planner.stats.generated++;
+
+	// Goal states end every path through them, so they are only remembered, never expanded.
+	if ((state.stateBits & planner.goalCare) == planner.goalValue)
+	{
+		if (planner.goalNode == kInvalidPlanNode || g < planner.nodes[planner.goalNode].g)
+		{
+			planner.goalNode = node;
+		}
+		return true;
+	}
+
+	if (entry.closedIn == planner.iteration)
+	{
+		if (!entry.inconsistent)
+		{
+			entry.inconsistent = true;
+			planner.inconsistent.push_back(node);
+		}
+	}
+	else
+	{
+		AnytimeOpen(planner, node);
+	}
+	return true;
+}
+
+// Publishes the path to goalNode as the current plan and computes its bound from the cheapest
+// g + h still waiting in the open and inconsistent sets.
+inline void AnytimePublish(AnytimePlanner& planner)
+{
+	// Summed along the path rather than read from the goal node: an ancestor may have been improved
+	// in place since, which makes the path cheaper than the goal's recorded g.
+	planner.plan.clear();
+	planner.planCost = 0.0f;
+	for (uint32_t i = planner.goalNode; planner.nodes[i].parent != kInvalidPlanNode; i = planner.nodes[i].parent)
+	{
+		planner.plan.push_back(planner.actions->actions[planner.nodes[i].action]);
+		planner.planCost += planner.actions->cost[planner.nodes[i].action];
+	}
+	std::reverse(planner.plan.begin(), planner.plan.end());
+
+	float lowerBound = planner.planCost;
+	for (const AnytimeNode& node : planner.nodes)
+	{
+		if (node.open || node.inconsistent)
+		{
+			lowerBound = std::min(lowerBound, node.g + node.h);
+		}
+	}
+
+	planner.bound = lowerBound > 0.0f ? std::min(planner.weight, planner.planCost / lowerBound) : 1.0f;
+	planner.bound = std::max(planner.bound, 1.0f);
+	planner.solutions++;
+}
+
+// Starts the next iteration with a lower weight: inconsistent nodes rejoin the open set and
+// every open node is requeued under the new priority.
+inline void AnytimeNextIteration(AnytimePlanner& planner)
+{
+	planner.weight = std::max(1.0f, planner.weight - planner.weightStep);
+	planner.iteration++;
+
+	for (const uint32_t node : planner.inconsistent)
+	{
+		planner.nodes[node].inconsistent = false;
+		planner.nodes[node].open = true;
+	}
+	planner.inconsistent.clear();
+
+	planner.openList.clear();
+	for (uint32_t node = 0; node < planner.nodes.size(); ++node)
+	{
+		if (planner.nodes[node].open)
+		{
+			AnytimeOpen(planner, node);
+		}
+	}
+}
+
+// Resets planner and seeds a search for goal from state. options.weight is the weight of the first
+// iteration (e.g. 3); each later iteration lowers it by weightStep, down to 1. Only forward search
+// is supported and options.partialOrderReduction is ignored. actions must stay alive and unchanged
+// until the search finishes.
+inline EPlanStatus AnytimePlanStart(AnytimePlanner& planner, const Goal& goal, const WorldState& state, const ActionTable& actions,
+	const PlanOptions& options, float weightStep = 0.5f)
+{
+	planner.openList.clear();
+	StateTableClear(planner.closedList);
+	planner.nodes.clear();
+	planner.inconsistent.clear();
+	planner.plan.clear();
+	planner.planCost = 0.0f;
+	planner.bound = 0.0f;
+	planner.solutions = 0;
+	planner.stats = {};
+
+	planner.actions = &actions;
+	planner.options = options;
+	planner.weightStep = weightStep > 0.0f ? weightStep : 1.0f;
+	planner.weight = std::max(1.0f, options.weight);
+	planner.iteration = 1;
+	planner.goalNode = kInvalidPlanNode;
+	GoalGetMasks(goal, planner.goalCare, planner.goalValue);
+
+	WorldState start = state;
+	if (options.goalRelevance)
+	{
+		const GoalRelevance& relevance = GoalRelevanceGet(planner.relevance, actions, planner.goalCare, planner.goalValue);
+		planner.actions = &relevance.table;
+		start.stateBits = state.stateBits & relevance.facts;
+	}
+	RelaxedHeuristicPrepare(planner.heuristic, planner.goalCare, planner.goalValue, *planner.actions);
+
+	AnytimeRelax(planner, start, kInvalidPlanNode, 0, 0.0f);
+	if (planner.goalNode != kInvalidPlanNode)
+	{
+		AnytimePublish(planner);
+		return planner.status = EPlanStatus::Found;
+	}
+
+	planner.status = planner.openList.empty() ? EPlanStatus::Failed : EPlanStatus::InProgress;
+	return planner.status;
+}
+
+// Improves the plan within budget. Returns InProgress while the plan may still get cheaper, with
+// the best plan so far in planner.plan once planner.solutions > 0. Returns Found once the plan is
+// proven optimal (for an admissible heuristic), and Failed when the goal is unreachable.
+inline EPlanStatus AnytimePlanStep(AnytimePlanner& planner, const PlanBudget& budget)
+{
+	if (planner.status != EPlanStatus::InProgress)
+	{
+		return planner.status;
+	}
+
+	const ActionTable& actions = *planner.actions;
+	const size_t actionCount = ActionTableSize(actions);
+	auto& openList = planner.openList;
+
+	for (uint32_t steps = 0; ; ++steps)
+	{
+		if (PlanBudgetExhausted(budget, steps))
+		{
+			return EPlanStatus::InProgress;
+		}
+
+		// Drop stale entries so the top is the real minimum.
+		while (!openList.empty())
+		{
+			const PlanOpenEntry& top = openList.getMin();
+			const AnytimeNode& node = planner.nodes[top.node];
+			if (node.open && top.f == AnytimePriority(planner, node))
+			{
+				break;
+			}
+			(void)openList.extractMin();
+		}
+
+		// The iteration ends once nothing left in the open set can beat the current plan under this weight.
+		const bool haveGoal = planner.goalNode != kInvalidPlanNode;
+		if (openList.empty() || (haveGoal && planner.nodes[planner.goalNode].g <= openList.getMin().f))
+		{
+			if (!haveGoal)
+			{
+				return planner.status = EPlanStatus::Failed;
+			}
+
+			AnytimePublish(planner);
+			if (planner.weight <= 1.0f || planner.bound <= 1.0f)
+			{
+				planner.bound = 1.0f;
+				return planner.status = EPlanStatus::Found;
+			}
+			AnytimeNextIteration(planner);
+			continue;
+		}
+
+		const PlanOpenEntry current = openList.extractMin();
+		planner.stats.extracted++;
+		planner.stats.expanded++;
+
+		AnytimeNode& node = planner.nodes[current.node];
+		node.open = false;
+		node.closedIn = planner.iteration;
+		const WorldState currentState = node.state;
+		const float currentG = node.g;
+
+		for (size_t first = 0; first < actionCount; first += kActionTableBlock)
+		{
+			uint64_t applicable = ActionTableScan(actions, first, currentState.stateBits, planner.successors);
+			while (applicable != 0)
+			{
+				const uint32_t lane = BitsetLowestBit(applicable);
+				applicable &= applicable - 1;
+
+				const uint32_t action = static_cast<uint32_t>(first + lane);
+				AnytimeRelax(planner, { planner.successors[lane] }, current.node, action, currentG + actions.cost[action]);
+			}
+		}
+	}
+}
+
+// Improves the plan by at most maxNodes open list entries. Deterministic for a given query.
+inline EPlanStatus AnytimePlanStep(AnytimePlanner& planner, uint32_t maxNodes)
+{
+	PlanBudget budget;
+	budget.maxNodes = maxNodes;
+	return AnytimePlanStep(planner, budget);
+}
+
+// Improves the plan until deadline passes, see PlanBudget for the granularity.
+inline EPlanStatus AnytimePlanStep(AnytimePlanner& planner, std::chrono::steady_clock::time_point deadline)
+{
+	PlanBudget budget;
+	budget.useDeadline = true;
+	budget.deadline = deadline;
+	return AnytimePlanStep(planner, budget);
+}
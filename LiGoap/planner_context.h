@@ -0,0 +1,206 @@
+// Michael Adaixo - 2025
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include "action.h"
+#include "action_table.h"
+#include "binary_heap.h"
+#include "bucket_queue.h"
+#include "goal_relevance.h"
+#include "heuristic.h"
+#include "partial_order.h"
+#include "plan_trace.h"
+#include "state_table.h"
+
+// Search node, stored in a contiguous pool and addressed by index.
+// The plan is rebuilt from the parent chain once the goal is reached.
+struct PlanNode
+{
+	WorldState state;
+	uint32_t parent; // kInvalidPlanNode for the start node
+	uint32_t action; // index into the action list that led here
+	float g;         // current plan
+};
+
+constexpr uint32_t kInvalidPlanNode = UINT32_MAX;
+
+// Node of the regressive search: the facts still required before the plan suffix can run.
+struct PartialPlanNode
+{
+	PartialState state;
+	uint32_t parent; // kInvalidPlanNode for the goal node
+	uint32_t action; // action that consumes this node's requirements and produces the parent's
+	float g;         // cost of the plan suffix
+};
+
+enum class EPlanDirection
+{
+	Forward,    // A* from the start state until the goal is satisfied
+	Regressive, // A* from the goal over required facts until the start state satisfies them
+};
+
+struct PlanOptions
+{
+	EPlanDirection direction = EPlanDirection::Forward;
+	EPlanHeuristic heuristic = EPlanHeuristic::GoalCount;
+	bool partialOrderReduction = false; // Forward search only expands strong stubborn sets
+	bool goalRelevance = false;         // Search only the goal's relevant actions over its relevant facts
+
+	// Weighted A*: f = g + weight * h. Above 1 the search goes deeper before widening and finds
+	// plans costing at most weight times the optimum, when the heuristic is admissible (HMax).
+	// BucketQueue needs g + weight * h to stay integral, so use whole weights with it.
+	float weight = 1.0f;
+};
+
+// Open list entry. Kept small and trivially copyable so the heap only moves PODs.
+struct PlanOpenEntry
+{
+	float f; // total
+	float h; // heuristic
+	uint32_t node;
+
+	// Ties on f prefer the entry closer to the goal.
+	bool operator<(const PlanOpenEntry& Other) const { return f < Other.f || (f == Other.f && h < Other.h); }
+	bool operator>(const PlanOpenEntry& Other) const { return f > Other.f || (f == Other.f && h > Other.h); }
+};
+
+enum class EPlanStatus
+{
+	InProgress, // Budget ran out; call PlanStep() again to continue
+	Found,      // Plan written to context.plan
+	Failed,     // Goal unreachable from the start state
+};
+
+// Work allowed for one PlanStep() call. The deadline is checked every kPlanDeadlineStride
+// extracted entries, so a step can overrun it by that many node expansions.
+struct PlanBudget
+{
+	uint32_t maxNodes = UINT32_MAX; // Open list entries to extract
+	bool useDeadline = false;
+	std::chrono::steady_clock::time_point deadline;
+};
+
+constexpr uint32_t kPlanDeadlineStride = 8;
+
+inline bool PlanBudgetExhausted(const PlanBudget& budget, uint32_t steps)
+{
+	if (steps >= budget.maxNodes)
+	{
+		return true;
+	}
+	return budget.useDeadline && steps > 0 && steps % kPlanDeadlineStride == 0
+		&& std::chrono::steady_clock::now() >= budget.deadline;
+}
+
+// Query of the search held by a context, kept between PlanStep() calls.
+struct PlanSearchState
+{
+	const ActionTable* actions = nullptr; // Must outlive the search
+	PlanOptions options;
+	WorldState start;
+	bitset_t goalCare;
+	bitset_t goalValue;
+	EPlanStatus status = EPlanStatus::Failed;
+
+	// Once Found: the plan costs at most bound times the optimum, for an admissible heuristic
+	float bound = 1.0f;
+
+	// Expanded node closest to the goal by heuristic, for partial plans
+	uint32_t bestNode = kInvalidPlanNode;
+	float bestH = 0.0f;
+};
+
+// PLANNER CONTEXT: Owns every buffer a Plan() call needs.
+// Keep one per thread and pass it to Plan() so steady-state planning does not allocate.
+// TOpenList is the open list policy: BinaryHeap works for any cost, BucketQueue
+// is faster when action costs and the heuristic are small integers.
+template<typename TOpenList>
+struct BasicPlannerContext : NoCopy
+{
+	using OpenList = TOpenList;
+
+	explicit BasicPlannerContext(int reserveSpace = 256)
+		: openList(reserveSpace)
+	{
+		nodes.reserve(reserveSpace);
+		StateTableReserve(closedList, reserveSpace);
+		plan.reserve(16);
+	}
+
+	TOpenList openList;
+	StateTable closedList; // Visited States and the best g reaching each
+	std::vector<PlanNode> nodes;
+	PartialStateTable regressionClosedList; // Only used by regressive search
+	std::vector<PartialPlanNode> regressionNodes;
+	std::vector<Action*> plan; // Result of the last Plan() call
+	ActionTable actionTable;   // Compiled copy of the action list passed to Plan()
+	RelaxedHeuristic heuristic; // Tables for the last (goal, action set), reused while both stay the same
+	PartialOrderTable partialOrder; // Interference relation for the last action set
+	GoalRelevanceCache relevance;   // Relevant subsets of recent goals
+	bitset_t successors[kActionTableBlock]; // Scratch output of ActionTableScan
+	PlanStats stats = {};
+	PlanSearchState search;
+#if defined(LIGOAP_TRACE)
+	PlanTrace trace; // Events of the last search
+#endif
+
+	// Number of buffers that had to grow during the last Plan() call.
+	// Reaches zero once the context has been warmed up on a workload.
+	uint32_t growCount = 0;
+};
+
+using PlannerContext = BasicPlannerContext<BinaryHeap<PlanOpenEntry>>;
+using BucketPlannerContext = BasicPlannerContext<BucketQueue<PlanOpenEntry>>;
+using IndexedPlannerContext = BasicPlannerContext<IndexedDaryHeap<PlanOpenEntry, 4>>;
+
+struct PlannerContextCapacity
+{
+	size_t openList;
+	size_t closedList;
+	size_t nodes;
+	size_t regressionClosedList;
+	size_t regressionNodes;
+	size_t plan;
+};
+
+template<typename TOpenList>
+inline PlannerContextCapacity PlannerContextGetCapacity(const BasicPlannerContext<TOpenList>& context)
+{
+	return { context.openList.capacity(), StateTableCapacity(context.closedList), context.nodes.capacity(),
+		StateTableCapacity(context.regressionClosedList), context.regressionNodes.capacity(), context.plan.capacity() };
+}
+
+template<typename TOpenList>
+inline uint32_t PlannerContextCountGrowth(const BasicPlannerContext<TOpenList>& context, const PlannerContextCapacity& before)
+{
+	const PlannerContextCapacity after = PlannerContextGetCapacity(context);
+	return (after.openList != before.openList ? 1u : 0u)
+		+ (after.closedList != before.closedList ? 1u : 0u)
+		+ (after.nodes != before.nodes ? 1u : 0u)
+		+ (after.regressionClosedList != before.regressionClosedList ? 1u : 0u)
+		+ (after.regressionNodes != before.regressionNodes ? 1u : 0u)
+		+ (after.plan != before.plan ? 1u : 0u);
+}
+
+// Clears the previous search but keeps all reserved memory.
+template<typename TOpenList>
+inline void PlannerContextReset(BasicPlannerContext<TOpenList>& context)
+{
+	context.openList.clear();
+	StateTableClear(context.closedList);
+	context.nodes.clear();
+	StateTableClear(context.regressionClosedList);
+	context.regressionNodes.clear();
+	context.plan.clear();
+	context.stats = {};
+	context.search.status = EPlanStatus::Failed;
+	context.search.bestNode = kInvalidPlanNode;
+	context.growCount = 0;
+#if defined(LIGOAP_TRACE)
+	PlanTraceClear(context.trace);
+#endif
+}
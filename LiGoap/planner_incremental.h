@@ -0,0 +1,408 @@
+// Michael Adaixo - 2025
+
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "action_table.h"
+#include "binary_heap.h"
+#include "goal.h"
+#include "planner_context.h"
+#include "planner_regressive.h"
+#include "state_table.h"
+
+constexpr float kIncrementalInfinity = std::numeric_limits<float>::infinity();
+
+// Node of the incremental regression graph: a set of required facts and its cost to the goal.
+struct IncrementalNode
+{
+	PartialState state;
+	float g;             // Cost to the goal as of the last expansion
+	float rhs;           // One-step lookahead of g from the node's in-edges
+	uint32_t firstIn;    // Edges from nodes that regress to this one
+	uint32_t firstOut;   // Edges to the nodes this one regresses to
+	uint32_t expandedQuery; // Query that last expanded the node, 0 if never
+	bool generated;      // Out-edges have been built
+};
+
+// Regression of node `from` through `action` yields node `to`.
+struct IncrementalEdge
+{
+	uint32_t from;
+	uint32_t to;
+	uint32_t action;
+	uint32_t nextIn;  // Next edge into `to`
+	uint32_t nextOut; // Next edge out of `from`
+};
+
+constexpr uint32_t kIncrementalNoEdge = UINT32_MAX;
+
+// Counters for the last PlanIncremental() call.
+struct IncrementalStats
+{
+	uint32_t expanded;   // Nodes processed by this query, new and repeated
+	uint32_t reExpanded; // Of those, nodes an earlier query had already expanded
+	uint32_t reused;     // Nodes expanded by earlier queries this one did not touch
+	uint32_t costChanges; // Actions whose cost differed from the previous query
+	bool rebuilt;        // Graph was discarded because the goal or the action set changed
+};
+
+// INCREMENTAL PLANNER: Lifelong Planning A* over the regression graph of one goal.
+// Nodes are sets of required facts and edges regress them through an action, exactly as in
+// regressive search, so the graph and every cost-to-goal in it are independent of the start
+// state. A new start state only changes which nodes count as reached; the search resumes from
+// the kept open list and usually needs few or no expansions. Changed action costs repair only
+// the nodes whose cheapest in-edge used them. The heuristic is zero because any estimate
+// towards one start state would be stale for the next.
+struct IncrementalPlanner : NoCopy
+{
+	IncrementalPlanner()
+		: openList(256)
+		, reachedList(256)
+	{
+	}
+
+	ActionTable actionTable;
+	uint64_t structureSignature = 0; // Hash of the action masks, without costs
+	std::vector<float> costs;        // Costs the graph was computed with
+	bitset_t goalCare = {};
+	bitset_t goalValue = {};
+	bool initialized = false;
+
+	std::vector<IncrementalNode> nodes; // Node 0 is the goal
+	std::vector<IncrementalEdge> edges;
+	PartialStateTable table;
+	BinaryHeap<PlanOpenEntry> openList; // Keyed by min(g, rhs); stale entries are skipped when popped
+	BinaryHeap<PlanOpenEntry> reachedList; // Consistent nodes of finite g that start reaches, keyed by g; stale entries are skipped when popped
+	WorldState start = {};                 // Start state of the current query
+	uint32_t query = 0;
+	uint32_t expandedTotal = 0; // Distinct nodes expanded by any query so far
+
+	std::vector<Action*> plan; // Result of the last PlanIncremental() call
+	IncrementalStats stats = {};
+};
+
+inline float IncrementalKey(const IncrementalNode& node)
+{
+	return node.g < node.rhs ? node.g : node.rhs;
+}
+
+inline void IncrementalReset(IncrementalPlanner& planner)
+{
+	planner.nodes.clear();
+	planner.edges.clear();
+	StateTableClear(planner.table);
+	planner.openList.clear();
+	planner.reachedList.clear();
+	planner.expandedTotal = 0;
+	planner.initialized = false;
+}
+
+inline uint64_t IncrementalStructureSignature(const ActionTable& table)
+{
+	const size_t count = ActionTableSize(table);
+	uint64_t signature = StateHashMix(count);
+	for (size_t i = 0; i < count; ++i)
+	{
+		signature = StateHashMix(signature ^ BitsetHash(table.preMask[i]));
+		signature = StateHashMix(signature ^ BitsetHash(table.preValue[i]));
+		signature = StateHashMix(signature ^ BitsetHash(table.effSet[i]));
+		signature = StateHashMix(signature ^ BitsetHash(table.effClear[i]));
+	}
+	return signature;
+}
+
+inline uint32_t IncrementalGetNode(IncrementalPlanner& planner, const PartialState& state)
+{
+	bool inserted;
+	auto* slot = StateTableFindOrInsert(planner.table, state, 0.0f, inserted);
+	if (inserted)
+	{
+		slot->node = static_cast<uint32_t>(planner.nodes.size());
+		planner.nodes.push_back({ state, kIncrementalInfinity, kIncrementalInfinity, kIncrementalNoEdge, kIncrementalNoEdge, 0, false });
+	}
+	return slot->node;
+}
+
+// True when start meets every requirement of node.
+inline bool IncrementalReached(const IncrementalNode& node, const WorldState& start)
+{
+	return !BitsetAny((start.stateBits ^ node.state.valueBits) & node.state.careMask);
+}
+
+// Queues the node on the open list when g and rhs disagree, and on the reached list when they
+// agree on a finite cost and the start state reaches it.
+inline void IncrementalQueue(IncrementalPlanner& planner, uint32_t node)
+{
+	const IncrementalNode& n = planner.nodes[node];
+	if (n.g != n.rhs)
+	{
+		planner.openList.insert({ IncrementalKey(n), 0.0f, node });
+	}
+	else if (n.g != kIncrementalInfinity && IncrementalReached(n, planner.start))
+	{
+		planner.reachedList.insert({ n.g, 0.0f, node });
+	}
+}
+
+// Recomputes rhs from every in-edge. Needed whenever a predecessor got more expensive.
+inline void IncrementalUpdateNode(IncrementalPlanner& planner, uint32_t node)
+{
+	if (node != 0)
+	{
+		float rhs = kIncrementalInfinity;
+		for (uint32_t e = planner.nodes[node].firstIn; e != kIncrementalNoEdge; e = planner.edges[e].nextIn)
+		{
+			const IncrementalEdge& edge = planner.edges[e];
+			const float cost = planner.nodes[edge.from].g + planner.costs[edge.action];
+			rhs = cost < rhs ? cost : rhs;
+		}
+		planner.nodes[node].rhs = rhs;
+	}
+	IncrementalQueue(planner, node);
+}
+
+// Builds the out-edges of node by regressing it through every action.
+inline void IncrementalGenerate(IncrementalPlanner& planner, uint32_t node)
+{
+	planner.nodes[node].generated = true;
+
+	const size_t actionCount = ActionTableSize(planner.actionTable);
+	for (size_t i = 0; i < actionCount; ++i)
+	{
+		PartialState predecessor;
+		if (!PartialStateRegress(planner.actionTable, i, planner.nodes[node].state, predecessor))
+		{
+			continue;
+		}
+
+		const uint32_t to = IncrementalGetNode(planner, predecessor);
+		const uint32_t edge = static_cast<uint32_t>(planner.edges.size());
+		planner.edges.push_back({ node, to, static_cast<uint32_t>(i), planner.nodes[to].firstIn, planner.nodes[node].firstOut });
+		planner.nodes[to].firstIn = edge;
+		planner.nodes[node].firstOut = edge;
+	}
+}
+
+// Makes start the state the reached list is kept for. The list is rebuilt with one pass over the
+// nodes when start changed, or once stale entries outnumber the nodes; otherwise IncrementalQueue()
+// keeps it current as nodes change.
+inline void IncrementalTrackStart(IncrementalPlanner& planner, const WorldState& start)
+{
+	if (planner.start == start && planner.reachedList.size() <= 2 * planner.nodes.size() + 64)
+	{
+		return;
+	}
+
+	planner.start = start;
+	planner.reachedList.clear();
+	for (uint32_t i = 0; i < planner.nodes.size(); ++i)
+	{
+		const IncrementalNode& node = planner.nodes[i];
+		if (node.g == node.rhs && node.g != kIncrementalInfinity && IncrementalReached(node, start))
+		{
+			planner.reachedList.insert({ node.g, 0.0f, i });
+		}
+	}
+}
+
+// Cheapest consistent node the start state reaches, or kInvalidPlanNode.
+inline uint32_t IncrementalFindBest(IncrementalPlanner& planner)
+{
+	while (!planner.reachedList.empty())
+	{
+		const PlanOpenEntry top = planner.reachedList.getMin();
+		const IncrementalNode& node = planner.nodes[top.node];
+		if (node.g == node.rhs && node.g == top.f)
+		{
+			return top.node;
+		}
+		(void)planner.reachedList.extractMin();
+	}
+	return kInvalidPlanNode;
+}
+
+// Pops stale entries; returns false when no inconsistent node is left.
+inline bool IncrementalTop(IncrementalPlanner& planner, PlanOpenEntry& outTop)
+{
+	while (!planner.openList.empty())
+	{
+		outTop = planner.openList.getMin();
+		const IncrementalNode& node = planner.nodes[outTop.node];
+		if (node.g != node.rhs && IncrementalKey(node) == outTop.f)
+		{
+			return true;
+		}
+		outTop = planner.openList.extractMin();
+	}
+	return false;
+}
+
+// Expands inconsistent nodes in key order until none is cheaper than the best node the start reaches.
+// Returns that node, or kInvalidPlanNode when the goal cannot be reached. The reached list must
+// track the start state, see IncrementalTrackStart().
+inline uint32_t IncrementalComputeShortestPath(IncrementalPlanner& planner)
+{
+	IncrementalStats& stats = planner.stats;
+
+	PlanOpenEntry top;
+	while (IncrementalTop(planner, top))
+	{
+		// Stop once the best reached node is settled: consistent and no cheaper key remains.
+		const uint32_t best = IncrementalFindBest(planner);
+		if (best != kInvalidPlanNode && planner.nodes[best].g <= top.f)
+		{
+			break;
+		}
+
+		top = planner.openList.extractMin();
+		const uint32_t u = top.node;
+
+		stats.expanded++;
+		if (planner.nodes[u].expandedQuery == 0)
+		{
+			planner.expandedTotal++;
+		}
+		else if (planner.nodes[u].expandedQuery != planner.query)
+		{
+			stats.reExpanded++;
+		}
+		planner.nodes[u].expandedQuery = planner.query;
+
+		if (!planner.nodes[u].generated)
+		{
+			IncrementalGenerate(planner, u);
+		}
+
+		if (planner.nodes[u].g > planner.nodes[u].rhs)
+		{
+			// Overconsistent: settle g and let successors improve through it.
+			planner.nodes[u].g = planner.nodes[u].rhs;
+			IncrementalQueue(planner, u);
+			for (uint32_t e = planner.nodes[u].firstOut; e != kIncrementalNoEdge; e = planner.edges[e].nextOut)
+			{
+				const IncrementalEdge& edge = planner.edges[e];
+				IncrementalNode& to = planner.nodes[edge.to];
+				const float cost = planner.nodes[u].g + planner.costs[edge.action];
+				if (cost < to.rhs)
+				{
+					to.rhs = cost;
+					IncrementalQueue(planner, edge.to);
+				}
+			}
+		}
+		else
+		{
+			// Underconsistent: g was too optimistic; invalidate it and everything derived from it.
+			planner.nodes[u].g = kIncrementalInfinity;
+			IncrementalUpdateNode(planner, u);
+			for (uint32_t e = planner.nodes[u].firstOut; e != kIncrementalNoEdge; e = planner.edges[e].nextOut)
+			{
+				IncrementalUpdateNode(planner, planner.edges[e].to);
+			}
+		}
+	}
+
+	return IncrementalFindBest(planner);
+}
+
+// Walks from node to the goal along in-edges that realise g. Actions come out in execution order.
+inline void IncrementalReconstruct(IncrementalPlanner& planner, uint32_t node)
+{
+	planner.plan.clear();
+
+	// Zero cost cycles can tie on g, so the walk is bounded by the node count.
+	for (size_t step = 0; node != 0 && step < planner.nodes.size(); ++step)
+	{
+		uint32_t bestEdge = kIncrementalNoEdge;
+		float bestCost = kIncrementalInfinity;
+		for (uint32_t e = planner.nodes[node].firstIn; e != kIncrementalNoEdge; e = planner.edges[e].nextIn)
+		{
+			const IncrementalEdge& edge = planner.edges[e];
+			const float cost = planner.nodes[edge.from].g + planner.costs[edge.action];
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestEdge = e;
+			}
+		}
+
+		planner.plan.push_back(planner.actionTable.actions[planner.edges[bestEdge].action]);
+		node = planner.edges[bestEdge].from;
+	}
+}
+
+// Plans from state to goal, reusing the graph of previous calls. The graph is rebuilt when
+// the goal or the actions' preconditions/effects changed; cost changes are repaired in place.
+// Returns true when a plan was found; it is written to planner.plan.
+inline bool PlanIncremental(IncrementalPlanner& planner, const Goal& goal, const WorldState& state, const std::vector<Action*>& actions)
+{
+	IncrementalStats& stats = planner.stats;
+	stats = {};
+	planner.query++;
+
+	ActionTableBuild(planner.actionTable, actions);
+	const uint64_t structureSignature = IncrementalStructureSignature(planner.actionTable);
+
+	bitset_t goalCare;
+	bitset_t goalValue;
+	GoalGetMasks(goal, goalCare, goalValue);
+
+	// Before any node changes, so the repair below already queues reached nodes for this start.
+	IncrementalTrackStart(planner, state);
+
+	if (!planner.initialized || planner.structureSignature != structureSignature
+		|| !(planner.goalCare == goalCare) || !(planner.goalValue == goalValue))
+	{
+		IncrementalReset(planner);
+		planner.structureSignature = structureSignature;
+		planner.goalCare = goalCare;
+		planner.goalValue = goalValue;
+		planner.costs.assign(planner.actionTable.cost.begin(), planner.actionTable.cost.begin() + actions.size());
+		planner.initialized = true;
+		stats.rebuilt = true;
+
+		PartialState goalState;
+		goalState.careMask = goalCare;
+		goalState.valueBits = goalValue;
+		const uint32_t root = IncrementalGetNode(planner, goalState);
+		planner.nodes[root].rhs = 0.0f;
+		IncrementalQueue(planner, root);
+	}
+	else
+	{
+		// Repair every node entered through an action whose cost changed.
+		for (size_t i = 0; i < actions.size(); ++i)
+		{
+			if (planner.costs[i] == planner.actionTable.cost[i])
+			{
+				continue;
+			}
+
+			planner.costs[i] = planner.actionTable.cost[i];
+			stats.costChanges++;
+			for (const IncrementalEdge& edge : planner.edges)
+			{
+				if (edge.action == i)
+				{
+					IncrementalUpdateNode(planner, edge.to);
+				}
+			}
+		}
+	}
+
+	const uint32_t expandedBefore = planner.expandedTotal;
+	const uint32_t best = IncrementalComputeShortestPath(planner);
+	stats.reused = expandedBefore - stats.reExpanded;
+
+	if (best == kInvalidPlanNode)
+	{
+		planner.plan.clear();
+		return false;
+	}
+
+	IncrementalReconstruct(planner, best);
+	return true;
+}
@@ -0,0 +1,485 @@
+// Michael Adaixo - 2025
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "action_table.h"
+#include "binary_heap.h"
+#include "goal.h"
+#include "goal_relevance.h"
+#include "heuristic.h"
+#include "partial_order.h"
+#include "planner_context.h"
+#include "state_table.h"
+
+// PARALLEL PLANNER: Hash-distributed A* (HDA*) for single searches too large for one core.
+// Every state has an owner worker picked by its hash. A worker only expands states it owns and
+// sends the successors it does not own to their owners, so each open list and closed list is
+// touched by one thread only. Workers keep expanding until every open entry left can no longer
+// beat the best plan found, so with an admissible heuristic the plan cost is optimal.
+constexpr uint32_t kParallelBatchSize = 64;      // Successors sent to a worker per queue push
+constexpr uint32_t kParallelFlushInterval = 16;  // Expansions between flushes of partly filled batches
+
+// Successor sent to the worker that owns its state.
+struct ParallelMessage
+{
+	WorldState state;
+	float g;
+	uint32_t parentWorker;
+	uint32_t parentNode;
+	uint32_t action;
+};
+
+struct ParallelBatch
+{
+	ParallelBatch* next;
+	uint32_t count;
+	ParallelMessage messages[kParallelBatchSize];
+};
+
+// Lock-free multi-producer single-consumer queue of batches. Producers push onto an intrusive
+// stack; the owner takes the whole stack at once, so it never races a producer on one node.
+struct alignas(64) ParallelInbox
+{
+	std::atomic<ParallelBatch*> head{ nullptr };
+};
+
+inline void ParallelInboxPush(ParallelInbox& inbox, ParallelBatch* batch)
+{
+	batch->next = inbox.head.load(std::memory_order_relaxed);
+	while (!inbox.head.compare_exchange_weak(batch->next, batch, std::memory_order_release, std::memory_order_relaxed))
+	{
+	}
+}
+
+inline ParallelBatch* ParallelInboxTakeAll(ParallelInbox& inbox)
+{
+	if (inbox.head.load(std::memory_order_relaxed) == nullptr)
+	{
+		return nullptr;
+	}
+	return inbox.head.exchange(nullptr, std::memory_order_acquire);
+}
+
+// Search node of one worker. The parent may be owned by another worker.
+struct ParallelNode
+{
+	WorldState state;
+	uint32_t parentWorker;
+	uint32_t parentNode; // kInvalidPlanNode for the start node
+	uint32_t action;
+	float g;
+};
+
+// Buffers of one worker. Only its own thread touches them during a search, except the inbox.
+struct alignas(64) ParallelWorker : NoCopy
+{
+	ParallelInbox inbox;
+
+	BinaryHeap<PlanOpenEntry> openList{ 256 };
+	StateTable closedList;
+	std::vector<ParallelNode> nodes;
+	RelaxedHeuristic heuristic;
+	PartialOrderTable partialOrder;
+	bitset_t successors[kActionTableBlock];
+
+	std::vector<ParallelBatch*> outbox;      // Batch being filled for each worker, or nullptr
+	std::vector<ParallelBatch*> freeBatches; // Received batches, reused for sending
+
+	PlanStats stats = {};
+	uint64_t sent = 0; // Successors sent to other workers
+};
+
+struct ParallelPlanner : NoCopy
+{
+	explicit ParallelPlanner(unsigned workerCount)
+	{
+		const unsigned count = workerCount > 0 ? workerCount : 1;
+		for (unsigned i = 0; i < count; ++i)
+		{
+			workers.push_back(std::make_unique<ParallelWorker>());
+			workers.back()->outbox.assign(count, nullptr);
+			StateTableReserve(workers.back()->closedList, 256);
+		}
+	}
+
+	~ParallelPlanner()
+	{
+		for (const std::unique_ptr<ParallelWorker>& worker : workers)
+		{
+			for (ParallelBatch* batch : worker->outbox)
+			{
+				delete batch;
+			}
+			for (ParallelBatch* batch : worker->freeBatches)
+			{
+				delete batch;
+			}
+			for (ParallelBatch* batch = ParallelInboxTakeAll(worker->inbox); batch != nullptr; )
+			{
+				ParallelBatch* next = batch->next;
+				delete batch;
+				batch = next;
+			}
+		}
+	}
+
+	std::vector<std::unique_ptr<ParallelWorker>> workers;
+	GoalRelevanceCache relevance;
+
+	// Shared search state
+	std::atomic<int64_t> work{ 0 }; // Active workers plus successors in flight; the search is over at zero
+	std::atomic<bool> done{ false };
+	std::atomic<float> incumbent{ INFINITY }; // Cost of the best plan found so far
+	std::mutex solutionMutex;
+	uint32_t solutionWorker = 0;
+	uint32_t solutionNode = kInvalidPlanNode;
+
+	std::vector<Action*> plan; // Result of the last PlanParallel() call
+	PlanStats stats = {};      // Summed over workers
+	uint64_t messages = 0;     // Successors that crossed workers in the last call
+};
+
+inline uint32_t ParallelOwner(const ParallelPlanner& planner, const WorldState& state)
+{
+	// The closed lists index by the low hash bits, so partition on the high ones.
+	return static_cast<uint32_t>((StateKeyHash(state) >> 32) % planner.workers.size());
+}
+
+// Query shared by the workers of one PlanParallel() call.
+struct ParallelQuery
+{
+	const ActionTable* actions;
+	PlanOptions options;
+	bitset_t goalCare;
+	bitset_t goalValue;
+};
+
+// Adds a successor to the worker's own search unless it is a duplicate or cannot beat the incumbent.
+inline void ParallelWorkerInsert(ParallelPlanner& planner, ParallelWorker& worker, const ParallelQuery& query, const ParallelMessage& message)
+{
+	StateTable::Slot* slot = StateTableRelax(worker.closedList, message.state, message.g);
+	if (slot == nullptr)
+	{
+		worker.stats.duplicates++;
+		return;
+	}
+
+	const float h = RelaxedHeuristicEvaluate(worker.heuristic, query.options.heuristic, message.state.stateBits);
+	if (h == kHeuristicDeadEnd)
+	{
+		worker.stats.deadEnds++;
+		return;
+	}
+	if (message.g + h >= planner.incumbent.load(std::memory_order_relaxed))
+	{
+		return;
+	}
+
+	const uint32_t node = static_cast<uint32_t>(worker.nodes.size());
+	slot->node = node;
+	worker.nodes.push_back({ message.state, message.parentWorker, message.parentNode, message.action, message.g });
+
+	worker.openList.insert({ message.g + h, h, node });
+	worker.stats.generated++;
+	worker.stats.openPeak = std::max(worker.stats.openPeak, static_cast<uint32_t>(worker.openList.size()));
+}
+
+inline void ParallelWorkerFlush(ParallelPlanner& planner, ParallelWorker& worker, uint32_t target)
+{
+	ParallelBatch* batch = worker.outbox[target];
+	if (batch == nullptr)
+	{
+		return;
+	}
+
+	// Count the messages before they become visible, so the total never drops to zero while they are queued.
+	planner.work.fetch_add(batch->count, std::memory_order_acq_rel);
+	worker.sent += batch->count;
+	ParallelInboxPush(planner.workers[target]->inbox, batch);
+	worker.outbox[target] = nullptr;
+}
+
+inline void ParallelWorkerFlushAll(ParallelPlanner& planner, ParallelWorker& worker)
+{
+	for (uint32_t target = 0; target < worker.outbox.size(); ++target)
+	{
+		ParallelWorkerFlush(planner, worker, target);
+	}
+}
+
+inline void ParallelWorkerSend(ParallelPlanner& planner, ParallelWorker& worker, uint32_t self, const ParallelQuery& query,
+	const ParallelMessage& message)
+{
+	const uint32_t target = ParallelOwner(planner, message.state);
+	if (target == self)
+	{
+		ParallelWorkerInsert(planner, worker, query, message);
+		return;
+	}
+
+	ParallelBatch*& batch = worker.outbox[target];
+	if (batch == nullptr)
+	{
+		if (worker.freeBatches.empty())
+		{
+			batch = new ParallelBatch;
+		}
+		else
+		{
+			batch = worker.freeBatches.back();
+			worker.freeBatches.pop_back();
+		}
+		batch->count = 0;
+	}
+
+	batch->messages[batch->count++] = message;
+	if (batch->count == kParallelBatchSize)
+	{
+		ParallelWorkerFlush(planner, worker, target);
+	}
+}
+
+// Moves every queued successor into the worker's search. Returns how many were taken.
+inline uint32_t ParallelWorkerReceive(ParallelPlanner& planner, ParallelWorker& worker, const ParallelQuery& query)
+{
+	uint32_t received = 0;
+	for (ParallelBatch* batch = ParallelInboxTakeAll(worker.inbox); batch != nullptr; )
+	{
+		for (uint32_t i = 0; i < batch->count; ++i)
+		{
+			ParallelWorkerInsert(planner, worker, query, batch->messages[i]);
+		}
+		received += batch->count;
+
+		ParallelBatch* next = batch->next;
+		worker.freeBatches.push_back(batch);
+		batch = next;
+	}
+	return received;
+}
+
+inline void ParallelWorkerExpand(ParallelPlanner& planner, ParallelWorker& worker, uint32_t self, const ParallelQuery& query, uint32_t node)
+{
+	const ActionTable& actions = *query.actions;
+	const size_t actionCount = ActionTableSize(actions);
+	const WorldState state = worker.nodes[node].state;
+	const float g = worker.nodes[node].g;
+
+	if (query.options.partialOrderReduction)
+	{
+		PartialOrderStubbornSet(worker.partialOrder, actions, state.stateBits, query.goalCare, query.goalValue);
+	}
+
+	for (size_t first = 0; first < actionCount; first += kActionTableBlock)
+	{
+		uint64_t applicable = ActionTableScan(actions, first, state.stateBits, worker.successors);
+		if (query.options.partialOrderReduction)
+		{
+			const uint64_t allowed = worker.partialOrder.allowed[first / kActionTableBlock];
+			worker.stats.pruned += BitsetCount(applicable & ~allowed);
+			applicable &= allowed;
+		}
+		while (applicable != 0)
+		{
+			const uint32_t lane = BitsetLowestBit(applicable);
+			applicable &= applicable - 1;
+
+			const uint32_t action = static_cast<uint32_t>(first + lane);
+			ParallelWorkerSend(planner, worker, self, query,
+				{ { worker.successors[lane] }, g + actions.cost[action], self, node, action });
+		}
+	}
+}
+
+// Runs worker self until every worker is idle and no successor is in flight.
+// A worker is idle when its open list holds nothing that could beat the incumbent.
+inline void ParallelWorkerRun(ParallelPlanner& planner, uint32_t self, const ParallelQuery& query)
+{
+	ParallelWorker& worker = *planner.workers[self];
+	bool active = true;
+	uint32_t expansions = 0;
+
+	while (!planner.done.load(std::memory_order_acquire))
+	{
+		if (!active)
+		{
+			if (worker.inbox.head.load(std::memory_order_acquire) == nullptr)
+			{
+				if (planner.work.load(std::memory_order_acquire) == 0)
+				{
+					planner.done.store(true, std::memory_order_release);
+					break;
+				}
+				std::this_thread::yield();
+				continue;
+			}
+
+			// Become active while the queued messages are still counted, so the total cannot touch zero.
+			planner.work.fetch_add(1, std::memory_order_acq_rel);
+			active = true;
+		}
+
+		const uint32_t received = ParallelWorkerReceive(planner, worker, query);
+		if (received != 0)
+		{
+			planner.work.fetch_sub(received, std::memory_order_acq_rel);
+		}
+
+		const float incumbent = planner.incumbent.load(std::memory_order_acquire);
+		if (worker.openList.empty() || worker.openList.getMin().f >= incumbent)
+		{
+			ParallelWorkerFlushAll(planner, worker);
+			active = false;
+			if (planner.work.fetch_sub(1, std::memory_order_acq_rel) == 1)
+			{
+				planner.done.store(true, std::memory_order_release);
+				break;
+			}
+			continue;
+		}
+
+		const PlanOpenEntry current = worker.openList.extractMin();
+		worker.stats.extracted++;
+
+		const ParallelNode& node = worker.nodes[current.node];
+		if (node.g > StateTableBestG(worker.closedList, node.state))
+		{
+			continue; // Superseded by a cheaper path
+		}
+
+		if ((node.state.stateBits & query.goalCare) == query.goalValue)
+		{
+			std::lock_guard<std::mutex> lock(planner.solutionMutex);
+			if (node.g < planner.incumbent.load(std::memory_order_relaxed))
+			{
+				planner.solutionWorker = self;
+				planner.solutionNode = current.node;
+				planner.incumbent.store(node.g, std::memory_order_release);
+			}
+			continue;
+		}
+
+		worker.stats.expanded++;
+		ParallelWorkerExpand(planner, worker, self, query, current.node);
+
+		if (++expansions % kParallelFlushInterval == 0)
+		{
+			ParallelWorkerFlushAll(planner, worker);
+		}
+	}
+}
+
+inline void ParallelPlannerReset(ParallelPlanner& planner, const ParallelQuery& query)
+{
+	for (const std::unique_ptr<ParallelWorker>& worker : planner.workers)
+	{
+		worker->openList.clear();
+		StateTableClear(worker->closedList);
+		worker->nodes.clear();
+		worker->stats = {};
+		worker->sent = 0;
+
+		// Batches left over when the last search stopped are recycled.
+		for (ParallelBatch*& batch : worker->outbox)
+		{
+			if (batch != nullptr)
+			{
+				worker->freeBatches.push_back(batch);
+				batch = nullptr;
+			}
+		}
+		for (ParallelBatch* batch = ParallelInboxTakeAll(worker->inbox); batch != nullptr; batch = batch->next)
+		{
+			worker->freeBatches.push_back(batch);
+		}
+
+		RelaxedHeuristicPrepare(worker->heuristic, query.goalCare, query.goalValue, *query.actions);
+		if (query.options.partialOrderReduction)
+		{
+			PartialOrderPrepare(worker->partialOrder, *query.actions);
+		}
+	}
+
+	planner.work.store(static_cast<int64_t>(planner.workers.size()), std::memory_order_relaxed);
+	planner.done.store(false, std::memory_order_relaxed);
+	planner.incumbent.store(INFINITY, std::memory_order_relaxed);
+	planner.solutionNode = kInvalidPlanNode;
+	planner.plan.clear();
+}
+
+// Searches with every worker of planner; the calling thread runs worker 0. Returns true when a plan
+// was found and leaves it in planner.plan. Forward search only: options.direction is ignored.
+inline bool PlanParallel(ParallelPlanner& planner, const Goal& goal, const WorldState& state, const ActionTable& actions,
+	const PlanOptions& options = {})
+{
+	ParallelQuery query;
+	query.actions = &actions;
+	query.options = options;
+	GoalGetMasks(goal, query.goalCare, query.goalValue);
+
+	WorldState start = state;
+	if (options.goalRelevance)
+	{
+		const GoalRelevance& relevance = GoalRelevanceGet(planner.relevance, actions, query.goalCare, query.goalValue);
+		query.actions = &relevance.table;
+		start.stateBits = state.stateBits & relevance.facts;
+	}
+
+	ParallelPlannerReset(planner, query);
+
+	const uint32_t owner = ParallelOwner(planner, start);
+	ParallelWorkerInsert(planner, *planner.workers[owner], query, { start, 0.0f, owner, kInvalidPlanNode, 0 });
+
+	std::vector<std::thread> threads;
+	threads.reserve(planner.workers.size() - 1);
+	for (uint32_t i = 1; i < planner.workers.size(); ++i)
+	{
+		threads.emplace_back([&planner, &query, i]() { ParallelWorkerRun(planner, i, query); });
+	}
+	ParallelWorkerRun(planner, 0, query);
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+
+	planner.stats = {};
+	planner.messages = 0;
+	for (const std::unique_ptr<ParallelWorker>& worker : planner.workers)
+	{
+		planner.stats.extracted += worker->stats.extracted;
+		planner.stats.expanded += worker->stats.expanded;
+		planner.stats.generated += worker->stats.generated;
+		planner.stats.duplicates += worker->stats.duplicates;
+		planner.stats.deadEnds += worker->stats.deadEnds;
+		planner.stats.openPeak += worker->stats.openPeak;
+		planner.stats.pruned += worker->stats.pruned;
+		planner.messages += worker->sent;
+	}
+
+	if (planner.solutionNode == kInvalidPlanNode)
+	{
+		return false;
+	}
+
+	// Follow parents across workers back to the start
+	uint32_t worker = planner.solutionWorker;
+	uint32_t node = planner.solutionNode;
+	while (planner.workers[worker]->nodes[node].parentNode != kInvalidPlanNode)
+	{
+		const ParallelNode& current = planner.workers[worker]->nodes[node];
+		planner.plan.push_back(query.actions->actions[current.action]);
+		worker = current.parentWorker;
+		node = current.parentNode;
+	}
+	std::reverse(planner.plan.begin(), planner.plan.end());
+	return true;
+}
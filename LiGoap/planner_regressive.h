@@ -0,0 +1,215 @@
+// Michael Adaixo - 2025
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "action_table.h"
+#include "goal.h"
+#include "heuristic.h"
+#include "planner_context.h"
+
+// Facts in state.careMask that the start state does not already satisfy.
+inline float PartialStateDistance(const PartialState& state, const WorldState& start)
+{
+	return static_cast<float>(BitsetCount((start.stateBits ^ state.valueBits) & state.careMask));
+}
+
+// Regresses state through action i of table. Returns false when the action is not
+// relevant (its effects support none of the required facts) or not consistent
+// (it breaks a required fact, or its preconditions contradict the remaining ones).
+inline bool PartialStateRegress(const ActionTable& table, size_t i, const PartialState& state, PartialState& outState)
+{
+	const bitset_t effSet = table.effSet[i];
+	const bitset_t effClear = table.effClear[i];
+	const bitset_t effMask = effSet | effClear;
+
+	const bitset_t supports = state.careMask & ((effSet & state.valueBits) | (effClear & ~state.valueBits));
+	const bitset_t breaks = state.careMask & ((effSet & ~state.valueBits) | (effClear & state.valueBits));
+	if (!BitsetAny(supports) || BitsetAny(breaks))
+	{
+		return false;
+	}
+
+	// Requirements the action does not produce must still hold before it runs.
+	const bitset_t remainingMask = state.careMask & ~effMask;
+	const bitset_t preMask = table.preMask[i];
+	const bitset_t preValue = table.preValue[i];
+	if (BitsetAny((state.valueBits ^ preValue) & remainingMask & preMask))
+	{
+		return false;
+	}
+
+	outState.careMask = remainingMask | preMask;
+	outState.valueBits = (state.valueBits & remainingMask) | preValue;
+	return true;
+}
+
+inline void PlanReconstructRegressive(const std::vector<PartialPlanNode>& nodes, uint32_t node, const std::vector<Action*>& actions, std::vector<Action*>& outPlan)
+{
+	// Walking towards the goal node already visits actions in execution order.
+	outPlan.clear();
+	for (uint32_t i = node; nodes[i].parent != kInvalidPlanNode; i = nodes[i].parent)
+	{
+		outPlan.push_back(actions[nodes[i].action]);
+	}
+}
+
+// Regressive search estimate of the cost to reach partial from the start state.
+template<typename TOpenList>
+inline float PlanRegressiveEstimate(BasicPlannerContext<TOpenList>& context, const PartialState& partial)
+{
+	const PlanSearchState& search = context.search;
+	return search.options.heuristic == EPlanHeuristic::GoalCount
+		? PartialStateDistance(partial, search.start)
+		: RelaxedHeuristicCombine(context.heuristic, search.options.heuristic, partial.careMask, partial.valueBits);
+}
+
+// Seeds the backward search from the goal in context.search. Only actions whose effects
+// support a required fact are expanded, so actions unrelated to the goal never add to
+// the branching factor. Expects a reset context.
+template<typename TOpenList>
+inline EPlanStatus PlanRegressiveBegin(BasicPlannerContext<TOpenList>& context)
+{
+	PlanSearchState& search = context.search;
+
+	// Goal node
+	PartialState goalState;
+	goalState.careMask = search.goalCare;
+	goalState.valueBits = search.goalValue;
+
+	// The start state is fixed, so relaxed literal costs are solved once and every node just sums or maxes them.
+	RelaxedHeuristic& heuristic = context.heuristic;
+	RelaxedHeuristicPrepare(heuristic, goalState.careMask, goalState.valueBits, *search.actions);
+	if (search.options.heuristic != EPlanHeuristic::GoalCount)
+	{
+		RelaxedHeuristicSolve(heuristic, search.options.heuristic, search.start.stateBits);
+	}
+
+	const float goalH = PlanRegressiveEstimate(context, goalState);
+	if (goalH == kHeuristicDeadEnd)
+	{
+		return EPlanStatus::Failed;
+	}
+
+	context.regressionNodes.push_back({ goalState, kInvalidPlanNode, 0, 0.0f });
+	StateTableRelax(context.regressionClosedList, goalState, 0.0f)->node = 0;
+	context.openList.insert({ search.options.weight * goalH, goalH, 0 });
+
+	context.stats.generated = 1;
+	context.stats.openPeak = 1;
+
+	search.bestNode = 0;
+	search.bestH = goalH;
+	return EPlanStatus::InProgress;
+}
+
+// Runs the backward search until the start state meets the remaining requirements, the open
+// list empties or budget runs out. The plan is written to context.plan.
+template<typename TOpenList>
+inline EPlanStatus PlanRegressiveStep(BasicPlannerContext<TOpenList>& context, const PlanBudget& budget)
+{
+	auto& openList = context.openList;
+	auto& closedList = context.regressionClosedList;
+	auto& nodes = context.regressionNodes;
+
+	PlanSearchState& search = context.search;
+	const ActionTable& actions = *search.actions;
+	const WorldState& state = search.start;
+
+	PlanStats& stats = context.stats;
+	const size_t actionCount = ActionTableSize(actions);
+
+	for (uint32_t steps = 0; !openList.empty(); ++steps)
+	{
+		if (PlanBudgetExhausted(budget, steps))
+		{
+			LIGOAP_TRACE_EVENT(context, Suspended, kInvalidPlanNode, kInvalidPlanNode, 0.0f, 0.0f);
+			return EPlanStatus::InProgress;
+		}
+
+		const PlanOpenEntry current = openList.extractMin();
+		stats.extracted++;
+
+		const PartialState currentState = nodes[current.node].state;
+		const float currentG = nodes[current.node].g;
+
+		// The start state meets every remaining requirement
+		if (PartialStateDistance(currentState, state) <= 0)
+		{
+			LIGOAP_TRACE_EVENT(context, Found, current.node, nodes[current.node].parent, currentG, current.h);
+			PlanReconstructRegressive(nodes, current.node, actions.actions, context.plan);
+			search.bound = search.options.weight;
+			return EPlanStatus::Found;
+		}
+
+		// Skip entries superseded by a cheaper path to the same requirements
+		if (currentG > StateTableBestG(closedList, currentState))
+		{
+			continue;
+		}
+		stats.expanded++;
+		LIGOAP_TRACE_EVENT(context, Expand, current.node, nodes[current.node].parent, currentG, current.h);
+
+		if (current.h < search.bestH)
+		{
+			search.bestH = current.h;
+			search.bestNode = current.node;
+		}
+
+		for (size_t i = 0; i < actionCount; ++i)
+		{
+			PartialState newState;
+			if (!PartialStateRegress(actions, i, currentState, newState))
+			{
+				continue;
+			}
+
+			const uint32_t actionIndex = static_cast<uint32_t>(i);
+			const float g = currentG + actions.cost[i];
+
+			auto* slot = StateTableRelax(closedList, newState, g);
+			if (slot == nullptr)
+			{
+				stats.duplicates++;
+				LIGOAP_TRACE_EVENT(context, Duplicate, kInvalidPlanNode, current.node, g, 0.0f);
+				continue;
+			}
+
+			const float h = PlanRegressiveEstimate(context, newState);
+			if (h == kHeuristicDeadEnd)
+			{
+				stats.deadEnds++;
+				LIGOAP_TRACE_EVENT(context, DeadEnd, kInvalidPlanNode, current.node, g, h);
+				continue;
+			}
+
+			if constexpr (TOpenList::kSupportsDecreaseKey)
+			{
+				if (slot->node != PartialStateTable::kNoNode)
+				{
+					nodes[slot->node] = { newState, current.node, actionIndex, g };
+					openList.insert({ g + search.options.weight * h, h, slot->node });
+					stats.generated++;
+					LIGOAP_TRACE_EVENT(context, Generate, slot->node, current.node, g, h);
+					stats.openPeak = std::max(stats.openPeak, static_cast<uint32_t>(openList.size()));
+					continue;
+				}
+			}
+
+			const uint32_t newNode = static_cast<uint32_t>(nodes.size());
+			slot->node = newNode;
+			nodes.push_back({ newState, current.node, actionIndex, g });
+
+			openList.insert({ g + search.options.weight * h, h, newNode });
+			stats.generated++;
+			LIGOAP_TRACE_EVENT(context, Generate, newNode, current.node, g, h);
+			stats.openPeak = std::max(stats.openPeak, static_cast<uint32_t>(openList.size()));
+		}
+	}
+
+	LIGOAP_TRACE_EVENT(context, Failed, kInvalidPlanNode, kInvalidPlanNode, 0.0f, 0.0f);
+	return EPlanStatus::Failed;
+}
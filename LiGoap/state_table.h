@@ -0,0 +1,177 @@
+// Michael Adaixo - 2025
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "worldstate.h"
+
+template<size_t Words>
+inline uint64_t StateKeyHash(const BasicWorldState<Words>& state)
+{
+	return BitsetHash(state.stateBits);
+}
+
+template<size_t Words>
+inline uint64_t StateKeyHash(const BasicPartialState<Words>& state)
+{
+	return StateHashMix(BitsetHash(state.careMask) ^ BitsetHash(state.valueBits));
+}
+
+// STATE TABLE: Open-addressing set of visited states with the best g seen for each.
+// Slots are tagged with a generation, so clearing is O(1) and never touches the array.
+// TKey is WorldState for forward search and PartialState for regressive search.
+template<typename TKey>
+struct BasicStateTable
+{
+	struct Slot
+	{
+		TKey key;
+		uint32_t generation; // Slot is live only when it matches BasicStateTable::generation
+		float bestG;
+		uint32_t node; // Search node currently holding bestG, kNoNode until assigned
+	};
+
+	static constexpr uint32_t kNoNode = UINT32_MAX;
+
+	std::vector<Slot> slots; // Power of two sized
+	uint32_t generation = 1;
+	uint32_t count = 0;
+};
+
+using StateTable = BasicStateTable<WorldState>;
+using PartialStateTable = BasicStateTable<PartialState>;
+
+template<typename TKey>
+inline void StateTableReserve(BasicStateTable<TKey>& table, size_t stateCount)
+{
+	// Keep the load factor at or below 1/2.
+	size_t capacity = 16;
+	while (capacity < stateCount * 2)
+	{
+		capacity *= 2;
+	}
+
+	if (capacity <= table.slots.size())
+	{
+		return;
+	}
+
+	using Slot = typename BasicStateTable<TKey>::Slot;
+	std::vector<Slot> oldSlots(capacity, Slot{ TKey{}, 0, 0.0f, BasicStateTable<TKey>::kNoNode });
+	oldSlots.swap(table.slots);
+
+	const size_t mask = table.slots.size() - 1;
+	for (const Slot& slot : oldSlots)
+	{
+		if (slot.generation != table.generation)
+		{
+			continue;
+		}
+
+		size_t index = StateKeyHash(slot.key) & mask;
+		while (table.slots[index].generation == table.generation)
+		{
+			index = (index + 1) & mask;
+		}
+		table.slots[index] = slot;
+	}
+}
+
+template<typename TKey>
+inline void StateTableClear(BasicStateTable<TKey>& table)
+{
+	table.count = 0;
+	if (++table.generation == 0)
+	{
+		// Generation wrapped; stale tags could now look live, so wipe them once.
+		for (auto& slot : table.slots)
+		{
+			slot.generation = 0;
+		}
+		table.generation = 1;
+	}
+}
+
+template<typename TKey>
+inline size_t StateTableCapacity(const BasicStateTable<TKey>& table)
+{
+	return table.slots.size();
+}
+
+// Returns the slot of state, inserting it with bestG = g when it has not been seen.
+// outInserted tells which of the two happened. The pointer is only valid until the next insertion.
+template<typename TKey>
+inline typename BasicStateTable<TKey>::Slot* StateTableFindOrInsert(BasicStateTable<TKey>& table, const TKey& state, float g, bool& outInserted)
+{
+	if ((table.count + 1) * 2 > table.slots.size())
+	{
+		StateTableReserve(table, table.count + 1);
+	}
+
+	const size_t mask = table.slots.size() - 1;
+	size_t index = StateKeyHash(state) & mask;
+	while (true)
+	{
+		auto& slot = table.slots[index];
+		if (slot.generation != table.generation)
+		{
+			slot = { state, table.generation, g, BasicStateTable<TKey>::kNoNode };
+			table.count++;
+			outInserted = true;
+			return &slot;
+		}
+
+		if (slot.key == state)
+		{
+			outInserted = false;
+			return &slot;
+		}
+
+		index = (index + 1) & mask;
+	}
+}
+
+// Records g for state if it is the best seen so far and returns its slot, so the caller can
+// attach a node to it. Returns nullptr when the state was already reached with a cost <= g.
+// The pointer is only valid until the next insertion.
+template<typename TKey>
+inline typename BasicStateTable<TKey>::Slot* StateTableRelax(BasicStateTable<TKey>& table, const TKey& state, float g)
+{
+	bool inserted;
+	auto* slot = StateTableFindOrInsert(table, state, g, inserted);
+	if (inserted)
+	{
+		return slot;
+	}
+
+	if (g < slot->bestG)
+	{
+		slot->bestG = g;
+		return slot;
+	}
+	return nullptr;
+}
+
+// Best g recorded for state, or a negative value when the state has not been seen.
+template<typename TKey>
+inline float StateTableBestG(const BasicStateTable<TKey>& table, const TKey& state)
+{
+	if (table.slots.empty())
+	{
+		return -1.0f;
+	}
+
+	const size_t mask = table.slots.size() - 1;
+	size_t index = StateKeyHash(state) & mask;
+	while (table.slots[index].generation == table.generation)
+	{
+		if (table.slots[index].key == state)
+		{
+			return table.slots[index].bestG;
+		}
+		index = (index + 1) & mask;
+	}
+	return -1.0f;
+}
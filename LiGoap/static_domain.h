@@ -0,0 +1,499 @@
+// Michael Adaixo - 2025
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <initializer_list>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+#include "binary_heap.h"
+#include "heuristic.h"
+#include "planner_context.h"
+#include "state_table.h"
+
+// STATIC DOMAIN: Action set and goal known at build time, described as constexpr data.
+// Plan<Domain>() instantiates a search specialised for it: goal relevance and the relaxed
+// heuristic's tables are computed by the compiler and evaluated by the runtime RelaxedSolve(),
+// and the applicability scan is unrolled into one masked compare per relevant action with the
+// masks as immediates.
+//
+// A domain is a type with two static constexpr members:
+//
+//   struct MyDomain
+//   {
+//       static constexpr StaticAction actions[] = { MakeStaticAction("Reload", 1, { { EKeyAtom::kWeaponArmed, true } }, { ... }), ... };
+//       static constexpr StaticGoal goal = MakeStaticGoal("KillEnemy", { { EKeyAtom::kTargetIsDead, true } });
+//   };
+//
+// Masks are single words: every EKeyAtom lives in the first word of the state at any
+// kWorldStateWords, so the search runs on that word and widens it only for the state table.
+static_assert(static_cast<size_t>(EKeyAtom::Count) <= 64, "Static masks hold every fact in one word");
+
+struct StaticFact
+{
+	EKeyAtom key;
+	bool value;
+};
+
+struct StaticAction
+{
+	const char* name = nullptr;
+	float cost = 0.0f;
+	bitset64_t preMask = 0;
+	bitset64_t preValue = 0;
+	bitset64_t effSet = 0;
+	bitset64_t effClear = 0;
+};
+
+struct StaticGoal
+{
+	const char* name = nullptr;
+	bitset64_t care = 0;
+	bitset64_t value = 0;
+};
+
+constexpr bitset64_t StaticBit(EKeyAtom key)
+{
+	return 1ull << static_cast<uint64_t>(key);
+}
+
+constexpr uint32_t StaticCount(bitset64_t bitset)
+{
+	uint32_t count = 0;
+	for (; bitset != 0; bitset &= bitset - 1)
+	{
+		count++;
+	}
+	return count;
+}
+
+constexpr StaticAction MakeStaticAction(const char* name, int cost, std::initializer_list<StaticFact> pre, std::initializer_list<StaticFact> eff)
+{
+	StaticAction action;
+	action.name = name;
+	action.cost = static_cast<float>(cost);
+	for (const StaticFact& fact : pre)
+	{
+		action.preMask |= StaticBit(fact.key);
+		action.preValue |= fact.value ? StaticBit(fact.key) : 0;
+	}
+	for (const StaticFact& fact : eff)
+	{
+		action.effSet |= fact.value ? StaticBit(fact.key) : 0;
+		action.effClear |= fact.value ? 0 : StaticBit(fact.key);
+	}
+	return action;
+}
+
+constexpr StaticGoal MakeStaticGoal(const char* name, std::initializer_list<StaticFact> satisfactions)
+{
+	StaticGoal goal;
+	goal.name = name;
+	for (const StaticFact& fact : satisfactions)
+	{
+		goal.care |= StaticBit(fact.key);
+		goal.value |= fact.value ? StaticBit(fact.key) : 0;
+	}
+	return goal;
+}
+
+// Compile-time counterpart of GoalRelevanceCompute().
+template<size_t Count>
+struct StaticRelevance
+{
+	bitset64_t facts = 0;
+	uint32_t actions[Count] = {}; // Indices of the relevant actions, in domain order
+	size_t count = 0;
+};
+
+template<typename Domain>
+constexpr auto StaticComputeRelevance()
+{
+	constexpr size_t count = std::size(Domain::actions);
+	StaticRelevance<count> relevance;
+
+	bitset64_t needTrue = Domain::goal.care & Domain::goal.value;
+	bitset64_t needFalse = Domain::goal.care & ~Domain::goal.value;
+	auto achieves = [&](const StaticAction& action)
+	{
+		return ((action.effSet & needTrue) | (action.effClear & needFalse)) != 0;
+	};
+
+	bool changed = true;
+	while (changed)
+	{
+		changed = false;
+		for (const StaticAction& action : Domain::actions)
+		{
+			const bitset64_t preTrue = action.preMask & action.preValue;
+			const bitset64_t preFalse = action.preMask & ~action.preValue;
+			if (achieves(action) && ((preTrue & ~needTrue) | (preFalse & ~needFalse)) != 0)
+			{
+				needTrue |= preTrue;
+				needFalse |= preFalse;
+				changed = true;
+			}
+		}
+	}
+
+	relevance.facts = needTrue | needFalse;
+	for (size_t i = 0; i < count; ++i)
+	{
+		if (achieves(Domain::actions[i]))
+		{
+			relevance.actions[relevance.count++] = static_cast<uint32_t>(i);
+		}
+	}
+	return relevance;
+}
+
+// Relevant actions with their effects masked to the relevant facts, as the goal relevance table does.
+template<typename Domain, size_t Count, size_t Relevant>
+constexpr std::array<StaticAction, Relevant> StaticRelevantActions(const StaticRelevance<Count>& relevance)
+{
+	std::array<StaticAction, Relevant> actions = {};
+	for (size_t i = 0; i < Relevant; ++i)
+	{
+		actions[i] = Domain::actions[relevance.actions[i]];
+		actions[i].effSet &= relevance.facts;
+		actions[i].effClear &= relevance.facts;
+	}
+	return actions;
+}
+
+// Every literal a static domain can name: its facts all live in the first state word.
+constexpr size_t kStaticLiteralCount = 2 * 64;
+
+// Facts some precondition of actions or the goal reads, split by the value read. Effects on any
+// other literal are left out of the relaxed tables, as RelaxedHeuristicPrepare() leaves them out.
+struct StaticReadFacts
+{
+	bitset64_t whenTrue = 0;
+	bitset64_t whenFalse = 0;
+};
+
+template<size_t Count>
+constexpr StaticReadFacts StaticComputeReadFacts(const std::array<StaticAction, Count>& actions, bitset64_t goalCare, bitset64_t goalValue)
+{
+	StaticReadFacts read;
+	read.whenTrue = goalCare & goalValue;
+	read.whenFalse = goalCare & ~goalValue;
+	for (const StaticAction& action : actions)
+	{
+		read.whenTrue |= action.preMask & action.preValue;
+		read.whenFalse |= action.preMask & ~action.preValue;
+	}
+	return read;
+}
+
+// Effect facts of action that land on a read literal.
+constexpr bitset64_t StaticReadEffects(const StaticAction& action, const StaticReadFacts& read)
+{
+	return (action.effSet & read.whenTrue) | (action.effClear & read.whenFalse);
+}
+
+template<size_t Count>
+constexpr size_t StaticPreLiteralCount(const std::array<StaticAction, Count>& actions)
+{
+	size_t total = 0;
+	for (const StaticAction& action : actions)
+	{
+		total += StaticCount(action.preMask);
+	}
+	return total;
+}
+
+template<size_t Count>
+constexpr size_t StaticEffLiteralCount(const std::array<StaticAction, Count>& actions, const StaticReadFacts& read)
+{
+	size_t total = 0;
+	for (const StaticAction& action : actions)
+	{
+		total += StaticCount(StaticReadEffects(action, read));
+	}
+	return total;
+}
+
+// Appends the literals of careMask in bit order, as RelaxedHeuristicAddLiterals() does.
+template<size_t Size>
+constexpr void StaticAppendLiterals(std::array<relaxed_literal_t, Size>& literals, size_t& next, bitset64_t careMask, bitset64_t valueBits)
+{
+	for (uint32_t bit = 0; bit < 64; ++bit)
+	{
+		if ((careMask >> bit) & 1ull)
+		{
+			literals[next++] = RelaxedLiteral(bit, ((valueBits >> bit) & 1ull) != 0);
+		}
+	}
+}
+
+// Compile-time counterpart of the tables RelaxedHeuristicPrepare() builds, with the same members,
+// so RelaxedSolve() and RelaxedEvaluate() run on it unchanged.
+template<size_t Count, size_t PreCount, size_t EffCount, size_t UsedCount>
+struct StaticRelaxedTables
+{
+	bitset64_t goalCare = 0;
+	bitset64_t goalValue = 0;
+
+	std::array<RelaxedAction, Count> actions = {};
+	std::array<relaxed_literal_t, PreCount + EffCount> literals = {};
+	std::array<relaxed_literal_t, UsedCount> usedLiterals = {};
+	std::array<uint32_t, PreCount> preActions = {};
+	std::array<uint32_t, kStaticLiteralCount + 1> preFirst = {};
+	std::array<bool, kStaticLiteralCount> goalLiteral = {};
+	uint32_t goalLiteralCount = 0;
+};
+
+template<size_t Count, size_t PreCount, size_t EffCount, size_t UsedCount>
+constexpr StaticRelaxedTables<Count, PreCount, EffCount, UsedCount> StaticBuildRelaxedTables(const std::array<StaticAction, Count>& actions,
+	bitset64_t goalCare, bitset64_t goalValue)
+{
+	StaticRelaxedTables<Count, PreCount, EffCount, UsedCount> tables;
+	tables.goalCare = goalCare;
+	tables.goalValue = goalValue;
+
+	const StaticReadFacts read = StaticComputeReadFacts(actions, goalCare, goalValue);
+	size_t next = 0;
+	for (size_t i = 0; i < Count; ++i)
+	{
+		RelaxedAction& action = tables.actions[i];
+		action.cost = actions[i].cost;
+
+		action.firstPre = static_cast<uint32_t>(next);
+		StaticAppendLiterals(tables.literals, next, actions[i].preMask, actions[i].preValue);
+		action.preCount = static_cast<uint32_t>(next) - action.firstPre;
+
+		action.firstEff = static_cast<uint32_t>(next);
+		StaticAppendLiterals(tables.literals, next, StaticReadEffects(actions[i], read), actions[i].effSet);
+		action.effCount = static_cast<uint32_t>(next) - action.firstEff;
+	}
+
+	size_t used = 0;
+	for (uint32_t bit = 0; bit < 64; ++bit)
+	{
+		if ((read.whenTrue >> bit) & 1ull)
+		{
+			tables.usedLiterals[used++] = RelaxedLiteral(bit, true);
+		}
+		if ((read.whenFalse >> bit) & 1ull)
+		{
+			tables.usedLiterals[used++] = RelaxedLiteral(bit, false);
+		}
+	}
+
+	for (const RelaxedAction& action : tables.actions)
+	{
+		for (uint32_t i = 0; i < action.preCount; ++i)
+		{
+			tables.preFirst[tables.literals[action.firstPre + i] + 1]++;
+		}
+	}
+	for (size_t literal = 0; literal < kStaticLiteralCount; ++literal)
+	{
+		tables.preFirst[literal + 1] += tables.preFirst[literal];
+	}
+
+	std::array<uint32_t, kStaticLiteralCount> fill = {};
+	for (size_t literal = 0; literal < kStaticLiteralCount; ++literal)
+	{
+		fill[literal] = tables.preFirst[literal];
+	}
+	for (uint32_t a = 0; a < Count; ++a)
+	{
+		const RelaxedAction& action = tables.actions[a];
+		for (uint32_t i = 0; i < action.preCount; ++i)
+		{
+			tables.preActions[fill[tables.literals[action.firstPre + i]]++] = a;
+		}
+	}
+
+	for (uint32_t bit = 0; bit < 64; ++bit)
+	{
+		if ((goalCare >> bit) & 1ull)
+		{
+			tables.goalLiteral[RelaxedLiteral(bit, ((goalValue >> bit) & 1ull) != 0)] = true;
+			tables.goalLiteralCount++;
+		}
+	}
+	return tables;
+}
+
+// First word of a state, which holds every fact a static domain can name.
+inline bitset64_t StaticStateWord(const bitset64_t& stateBits)
+{
+	return stateBits;
+}
+
+template<size_t Words>
+inline bitset64_t StaticStateWord(const BitsetWords<Words>& stateBits)
+{
+	return stateBits.words[0];
+}
+
+// Sets the first word of a state to word and clears the others.
+inline void StaticSetStateWord(bitset64_t& stateBits, bitset64_t word)
+{
+	stateBits = word;
+}
+
+template<size_t Words>
+inline void StaticSetStateWord(BitsetWords<Words>& stateBits, bitset64_t word)
+{
+	BitsetInit(stateBits);
+	stateBits.words[0] = word;
+}
+
+inline WorldState StaticMakeState(bitset64_t word)
+{
+	WorldState state;
+	StaticSetStateWord(state.stateBits, word);
+	return state;
+}
+
+// Everything Plan<Domain>() needs, evaluated once per domain by the compiler.
+template<typename Domain>
+struct StaticDomainTables
+{
+	static constexpr auto relevance = StaticComputeRelevance<Domain>();
+	static constexpr size_t kActionCount = relevance.count;
+	static constexpr bitset64_t kFacts = relevance.facts;
+	static constexpr size_t kFactCount = StaticCount(kFacts);
+	static constexpr bitset64_t kGoalCare = Domain::goal.care;
+	static constexpr bitset64_t kGoalValue = Domain::goal.value;
+
+	static constexpr std::array<StaticAction, kActionCount> actions = StaticRelevantActions<Domain, std::size(Domain::actions), kActionCount>(relevance);
+	static constexpr StaticReadFacts read = StaticComputeReadFacts(actions, kGoalCare, kGoalValue);
+	static constexpr auto relaxed = StaticBuildRelaxedTables<kActionCount, StaticPreLiteralCount(actions), StaticEffLiteralCount(actions, read),
+		StaticCount(read.whenTrue) + StaticCount(read.whenFalse)>(actions, kGoalCare, kGoalValue);
+};
+
+// Same search state as the runtime planner, minus everything the compiler already knows.
+struct StaticPlannerContext : NoCopy
+{
+	explicit StaticPlannerContext(int reserveSpace = 256)
+		: openList(reserveSpace)
+	{
+		nodes.reserve(reserveSpace);
+		StateTableReserve(closedList, reserveSpace);
+		plan.reserve(16);
+	}
+
+	BinaryHeap<PlanOpenEntry> openList;
+	StateTable closedList;
+	std::vector<PlanNode> nodes; // PlanNode::action indexes the domain's relevant actions
+	std::vector<const StaticAction*> plan; // Result of the last Plan<Domain>() call, pointing into Domain::actions
+	RelaxedScratch relaxed; // Scratch of the relaxed heuristic
+	PlanStats stats = {};
+};
+
+// Calls visit(action, successor) for each relevant action applicable in stateBits, in domain order.
+template<typename Tables, size_t Index, typename F>
+inline void StaticVisitIfApplicable(bitset64_t stateBits, F& visit)
+{
+	constexpr StaticAction action = Tables::actions[Index];
+	if ((stateBits & action.preMask) == action.preValue)
+	{
+		visit(static_cast<uint32_t>(Index), (stateBits & ~action.effClear) | action.effSet);
+	}
+}
+
+template<typename Tables, typename F, size_t... Indices>
+inline void StaticForEachApplicable(bitset64_t stateBits, F& visit, std::index_sequence<Indices...>)
+{
+	(StaticVisitIfApplicable<Tables, Indices>(stateBits, visit), ...);
+}
+
+// A* for Domain::goal from state, over the goal's relevant actions and facts. Returns true when a
+// plan was found; the plan is left in context.plan. Finds plans of the same cost as the runtime
+// Plan() with the same heuristic and PlanOptions::goalRelevance set.
+template<typename Domain, EPlanHeuristic Kind = EPlanHeuristic::GoalCount>
+inline bool Plan(StaticPlannerContext& context, const WorldState& state)
+{
+	using Tables = StaticDomainTables<Domain>;
+
+	auto& openList = context.openList;
+	auto& closedList = context.closedList;
+	auto& nodes = context.nodes;
+	PlanStats& stats = context.stats;
+
+	openList.clear();
+	StateTableClear(closedList);
+	nodes.clear();
+	context.plan.clear();
+	stats = {};
+	RelaxedScratchResize(context.relaxed, Tables::kActionCount);
+
+	const bitset64_t startBits = StaticStateWord(state.stateBits) & Tables::kFacts;
+	const WorldState start = StaticMakeState(startBits);
+	const float startH = RelaxedEvaluate(Tables::relaxed, context.relaxed, Kind, startBits);
+	if (startH == kHeuristicDeadEnd)
+	{
+		return false;
+	}
+
+	nodes.push_back({ start, kInvalidPlanNode, 0, 0.0f });
+	StateTableRelax(closedList, start, 0.0f)->node = 0;
+	openList.insert({ startH, startH, 0 });
+	stats.generated = 1;
+	stats.openPeak = 1;
+
+	while (!openList.empty())
+	{
+		const PlanOpenEntry current = openList.extractMin();
+		stats.extracted++;
+
+		const WorldState currentState = nodes[current.node].state;
+		const bitset64_t currentBits = StaticStateWord(currentState.stateBits);
+		const float currentG = nodes[current.node].g;
+
+		if ((currentBits & Tables::kGoalCare) == Tables::kGoalValue)
+		{
+			for (uint32_t i = current.node; nodes[i].parent != kInvalidPlanNode; i = nodes[i].parent)
+			{
+				context.plan.push_back(&Domain::actions[Tables::relevance.actions[nodes[i].action]]);
+			}
+			std::reverse(context.plan.begin(), context.plan.end());
+			return true;
+		}
+
+		if (currentG > StateTableBestG(closedList, currentState))
+		{
+			continue;
+		}
+		stats.expanded++;
+
+		auto visit = [&](uint32_t action, bitset64_t successor)
+		{
+			const WorldState newState = StaticMakeState(successor);
+			const float g = currentG + Tables::actions[action].cost;
+
+			StateTable::Slot* slot = StateTableRelax(closedList, newState, g);
+			if (slot == nullptr)
+			{
+				stats.duplicates++;
+				return;
+			}
+
+			const float h = RelaxedEvaluate(Tables::relaxed, context.relaxed, Kind, successor);
+			if (h == kHeuristicDeadEnd)
+			{
+				stats.deadEnds++;
+				return;
+			}
+
+			const uint32_t newNode = static_cast<uint32_t>(nodes.size());
+			slot->node = newNode;
+			nodes.push_back({ newState, current.node, action, g });
+			openList.insert({ g + h, h, newNode });
+			stats.generated++;
+			stats.openPeak = std::max(stats.openPeak, static_cast<uint32_t>(openList.size()));
+		};
+		StaticForEachApplicable<Tables>(currentBits, visit, std::make_index_sequence<Tables::kActionCount>());
+	}
+
+	return false;
+}
@@ -0,0 +1,204 @@
+// Michael Adaixo - 2025
+
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "types.h"
+
+// WORK STEALING POOL: Fixed set of workers that run index ranges in parallel.
+// Each worker owns a contiguous slice of the range and takes small chunks from its
+// front. When it runs dry it steals the back half of another worker's slice, so
+// uneven per-item cost (e.g. easy vs. hard searches) still keeps every core busy.
+// The calling thread takes part as worker 0, so a pool of N workers spawns N - 1 threads.
+class WorkStealingPool : NoCopy {
+public:
+	explicit WorkStealingPool(unsigned workers)
+	{
+		const unsigned count = workers > 0 ? workers : 1;
+		queues = std::make_unique<Queue[]>(count);
+		workerTotal = count;
+
+		threads.reserve(count - 1);
+		for (unsigned i = 1; i < count; ++i)
+		{
+			threads.emplace_back([this, i]() { workerLoop(i); });
+		}
+	}
+
+	~WorkStealingPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(jobMutex);
+			stopping = true;
+		}
+		jobReady.notify_all();
+
+		for (std::thread& thread : threads)
+		{
+			thread.join();
+		}
+	}
+
+	unsigned workerCount() const { return workerTotal; }
+
+	// Calls fn(workerIndex, itemIndex) once for every item in [0, count) and blocks until all are done.
+	// fn must be safe to call concurrently for different items; workerIndex is stable per thread.
+	template<typename F>
+	void parallelFor(size_t count, size_t grain, F&& fn)
+	{
+		if (count == 0)
+		{
+			return;
+		}
+
+		using Fn = std::remove_reference_t<F>;
+		job.invoke = [](void* user, unsigned worker, size_t index) { (*static_cast<Fn*>(user))(worker, index); };
+		job.user = const_cast<void*>(static_cast<const void*>(&fn));
+		job.grain = grain > 0 ? grain : 1;
+
+		// Split the range evenly; stealing corrects any imbalance.
+		const size_t slice = (count + workerTotal - 1) / workerTotal;
+		for (unsigned i = 0; i < workerTotal; ++i)
+		{
+			const size_t begin = std::min(count, slice * i);
+			const size_t end = std::min(count, begin + slice);
+			queues[i].begin = begin;
+			queues[i].end = end;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(jobMutex);
+			busyWorkers = workerTotal;
+			jobId++;
+		}
+		jobReady.notify_all();
+
+		runJob(0);
+
+		std::unique_lock<std::mutex> lock(jobMutex);
+		jobDone.wait(lock, [this]() { return busyWorkers == 0; });
+	}
+
+private:
+	struct Job
+	{
+		void (*invoke)(void* user, unsigned worker, size_t index) = nullptr;
+		void* user = nullptr;
+		size_t grain = 1;
+	};
+
+	struct alignas(64) Queue
+	{
+		std::mutex mutex;
+		size_t begin = 0;
+		size_t end = 0;
+	};
+
+	void workerLoop(unsigned worker)
+	{
+		uint64_t seenJob = 0;
+		while (true)
+		{
+			{
+				std::unique_lock<std::mutex> lock(jobMutex);
+				jobReady.wait(lock, [&]() { return stopping || jobId != seenJob; });
+				if (stopping)
+				{
+					return;
+				}
+				seenJob = jobId;
+			}
+
+			runJob(worker);
+		}
+	}
+
+	void runJob(unsigned worker)
+	{
+		size_t begin = 0;
+		size_t end = 0;
+		while (takeLocal(worker, begin, end) || steal(worker, begin, end))
+		{
+			for (size_t index = begin; index < end; ++index)
+			{
+				job.invoke(job.user, worker, index);
+			}
+		}
+
+		std::lock_guard<std::mutex> lock(jobMutex);
+		if (--busyWorkers == 0)
+		{
+			jobDone.notify_all();
+		}
+	}
+
+	bool takeLocal(unsigned worker, size_t& outBegin, size_t& outEnd)
+	{
+		Queue& queue = queues[worker];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (queue.begin >= queue.end)
+		{
+			return false;
+		}
+
+		outBegin = queue.begin;
+		outEnd = std::min(queue.end, queue.begin + job.grain);
+		queue.begin = outEnd;
+		return true;
+	}
+
+	bool steal(unsigned thief, size_t& outBegin, size_t& outEnd)
+	{
+		for (unsigned offset = 1; offset < workerTotal; ++offset)
+		{
+			Queue& victim = queues[(thief + offset) % workerTotal];
+
+			size_t begin = 0;
+			size_t end = 0;
+			{
+				std::lock_guard<std::mutex> lock(victim.mutex);
+				const size_t remaining = victim.end > victim.begin ? victim.end - victim.begin : 0;
+				if (remaining == 0)
+				{
+					continue;
+				}
+
+				// Take the back half, leaving the front to the owner.
+				const size_t stolen = remaining > 1 ? remaining / 2 : 1;
+				end = victim.end;
+				begin = end - stolen;
+				victim.end = begin;
+			}
+
+			Queue& own = queues[thief];
+			std::lock_guard<std::mutex> lock(own.mutex);
+			outBegin = begin;
+			outEnd = std::min(end, begin + job.grain);
+			own.begin = outEnd;
+			own.end = end;
+			return true;
+		}
+		return false;
+	}
+
+private:
+	std::unique_ptr<Queue[]> queues;
+	std::vector<std::thread> threads;
+	unsigned workerTotal = 1;
+
+	Job job;
+	std::mutex jobMutex;
+	std::condition_variable jobReady;
+	std::condition_variable jobDone;
+	uint64_t jobId = 0;
+	unsigned busyWorkers = 0;
+	bool stopping = false;
+};
@@ -37,6 +37,40 @@ enum class EKeyAtom : uint64_t {
 	Count
 };
 
+// Name of each EKeyAtom, indexed by value. Domain files refer to facts by these names, so a
+// reordered enum is caught when a compiled file is loaded instead of silently remapping its masks.
+constexpr const char* kKeyAtomNames[] = {
+	"Empty",
+	"kTargetIsDead",
+	"kWeaponArmed",
+	"kWeaponLoaded",
+	"kHasCover",
+	"kAtObject",
+	"kAtLocation",
+	"kStamina",
+	"kHasRadio",
+	"kHasPistolAmmo",
+	"kHasRifleAmmo",
+	"kHasSniperAmmo",
+	"kHasRifle",
+	"kHasSniper",
+	"kAccuracyIncreased",
+	"kHasHighGround",
+	"kIsStealthy",
+	"kSupportAvailable",
+	"kTargetMarked",
+	"kDestination",
+	"kIsCrouched",
+	"kIsProne",
+	"kInsideBuilding",
+	"kUsingPistol",
+	"kUsingRifle",
+	"kUsingSniper",
+	"kInVehicle",
+	"kVehicleRunning",
+};
+static_assert(sizeof(kKeyAtomNames) / sizeof(kKeyAtomNames[0]) == static_cast<size_t>(EKeyAtom::Count), "kKeyAtomNames must name every EKeyAtom");
+
 using key_type = EKeyAtom;
 using key_map = std::unordered_map<key_type, bool>;
 
@@ -2,20 +2,43 @@
 
 #pragma once
 
-struct WorldState
+#include <cstdint>
+#include <functional>
+
+#include "bitset.h"
+
+// Templated on the number of 64-bit words so domains with more than 64 facts
+// can widen it; WorldState uses the width chosen by kWorldStateWords.
+template<size_t Words>
+struct BasicWorldState
 {
 	// Bit Position; KeyAtom
 	// Bit Value; Bool
-	uint64_t stateBits;
+	Bitset<Words> stateBits;
 
-	bool operator==(const WorldState& other) const { return stateBits == other.stateBits; }
+	bool operator==(const BasicWorldState& other) const { return stateBits == other.stateBits; }
 };
 
-template<>
-struct std::hash<WorldState>
+using WorldState = BasicWorldState<kWorldStateWords>;
+
+template<size_t Words>
+struct std::hash<BasicWorldState<Words>>
 {
-	size_t operator()(const WorldState& state) const noexcept
+	size_t operator()(const BasicWorldState<Words>& state) const noexcept
 	{
-		return state.stateBits;
+		return static_cast<size_t>(BitsetHash(state.stateBits));
 	}
 };
+
+// Set of required facts used by regressive search: the bits in careMask must
+// match valueBits, every other fact is free.
+template<size_t Words>
+struct BasicPartialState
+{
+	Bitset<Words> careMask;
+	Bitset<Words> valueBits;
+
+	bool operator==(const BasicPartialState& other) const { return careMask == other.careMask && valueBits == other.valueBits; }
+};
+
+using PartialState = BasicPartialState<kWorldStateWords>;